@@ -8,39 +8,17 @@ Note:             -
 
 BMV51M001 moduleMIDIInterface;  //To build the object
 
-uint8_t parameter[10];
-uint8_t velocity = 0;
-uint8_t noteNumber = 0;
-uint8_t channel = 1;
-uint8_t type = 0;
-
 void setup()
 {
     moduleMIDIInterface.begin();  //Initialize the object, start MIDI, default listening channel is 1
+    //Forward the received bytes to the MIDI device as soon as they arrive(no decode and re-encode)
+    moduleMIDIInterface.setThru(&moduleMIDIInterface);
+    moduleMIDIInterface.setThruChannelMask(1 << 0);  //Channel 1 only
+    moduleMIDIInterface.setThruTypeMask(MIDI_TYPE_BIT(NoteOn) | MIDI_TYPE_BIT(NoteOff));  //Notes only
 }
 
 void loop()
 {
-     // Read the MIDI message for the MIDI Wrench APP
-    if (moduleMIDIInterface.isMIDIMessageOK())    
-    {
-        moduleMIDIInterface.getMIDIMessage(parameter); //Gets MIDI message data
-        //Sends a MIDI message to the connected MIDI device
-        type = parameter[0];//The first byte is the MIDI message typeThe channel is not included here(the channel is separated to the fourth byte).
-        noteNumber = parameter[1]; //The second byte is the note information, see MIDI protocol manual for details
-        velocity= parameter[2]; //The third byte is the strength information, see MIDI protocol manual for details
-        channel = parameter[3]; //The fourth byte is the channel information
-
-        switch(type)
-        {
-            case NoteOn:  
-                moduleMIDIInterface.sendNoteOn(noteNumber, velocity, channel);
-                break;
-            case NoteOff:  
-                moduleMIDIInterface.sendNoteOff(noteNumber, velocity, channel);
-                break;
-            default:
-                break;
-        }
-    }
+    // Read the MIDI message for the MIDI Wrench APP, the notes are forwarded while reading
+    moduleMIDIInterface.isMIDIMessageOK();
 }
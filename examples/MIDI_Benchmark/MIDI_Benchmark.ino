@@ -0,0 +1,169 @@
+/******************************************************************
+File:             MIDI_Benchmark.ino
+Description:      Measure the receive path(parse + inputFilter + launchCallback)
+                  and the soft thru by replaying recorded MIDI workloads from RAM
+                  through MidiMemoryTransport, and print the results on the Serial Monitor
+Note:             No MIDI device is needed, set the Serial Monitor to 115200 baud.
+                  The same workloads run on the PC with extras/host(make bench)
+******************************************************************/
+#include "BMV51M001.h"
+#include "BM_MIDITransport.h"
+
+#define WORKLOAD_SIZE   512   //Bytes of each workload
+#define REPEAT          20    //Replays of each workload
+
+MidiMemoryTransport memoryTransport;
+BasicMidiInterface<MidiMemoryTransport> benchMIDIInterface(&memoryTransport);
+
+uint8_t workload[WORKLOAD_SIZE];
+uint8_t thruOutput[WORKLOAD_SIZE];
+MidiMemoryTransport thruTransport(thruOutput, sizeof(thruOutput));
+BasicMidiInterface<MidiMemoryTransport> thruMIDIInterface(&thruTransport);
+uint16_t workloadLength = 0;
+volatile uint32_t callbackCount = 0;
+
+void buildChords();
+void buildControlSweep();
+void buildRunningStatus();
+void buildClockInterleave();
+void buildSysExDump();
+void addByte(uint8_t data);
+void runWorkload(const __FlashStringHelper *name);
+uint32_t replay(uint32_t &messages);
+
+void onNote(uint8_t channel, uint8_t note, uint8_t velocity) { callbackCount++; }
+void onControlChange(uint8_t channel, uint8_t number, uint8_t value) { callbackCount++; }
+void onClock(void) { callbackCount++; }
+void onSysEx(uint8_t *array, uint16_t size) { callbackCount++; }
+
+void setup()
+{
+    Serial.begin(115200);
+    benchMIDIInterface.begin(MIDI_CHANNEL_OMNI);
+    thruMIDIInterface.begin(MIDI_CHANNEL_OFF);
+    Serial.println(F("workload        bytes  msgs  ns/byte  msgs/s  callback ns/msg  thru ns/byte"));
+}
+
+void loop()
+{
+    buildChords();          runWorkload(F("note chords   "));
+    buildControlSweep();    runWorkload(F("CC sweep      "));
+    buildRunningStatus();   runWorkload(F("running status"));
+    buildClockInterleave(); runWorkload(F("clock + notes "));
+    buildSysExDump();       runWorkload(F("SysEx dump    "));
+    Serial.println();
+    delay(5000);
+}
+
+/*6-note chords on and off, a status byte for every message*/
+void buildChords()
+{
+    workloadLength = 0;
+    while (workloadLength + 6 <= WORKLOAD_SIZE)
+    {
+        uint8_t note = 48 + (workloadLength / 6) % 24;
+        addByte(NoteOn);  addByte(note); addByte(100);
+        addByte(NoteOff); addByte(note); addByte(0);
+    }
+}
+/*Modulation wheel sweep on channel 1 with running status*/
+void buildControlSweep()
+{
+    workloadLength = 0;
+    addByte(ControlChange);
+    for (uint8_t value = 0; workloadLength + 2 <= WORKLOAD_SIZE; value++)
+    {
+        addByte(ModulationWheel); addByte(value & 0x7f);
+    }
+}
+/*Notes on channel 2 sent with running status(NoteOn with 0 velocity as NoteOff)*/
+void buildRunningStatus()
+{
+    workloadLength = 0;
+    addByte(NoteOn | 1);
+    for (uint8_t note = 0; workloadLength + 4 <= WORKLOAD_SIZE; note++)
+    {
+        addByte(note & 0x7f); addByte(90);
+        addByte(note & 0x7f); addByte(0);
+    }
+}
+/*Timing Clock interleaved inside note messages*/
+void buildClockInterleave()
+{
+    workloadLength = 0;
+    while (workloadLength + 5 <= WORKLOAD_SIZE)
+    {
+        addByte(NoteOn); addByte(Clock); addByte(60); addByte(Clock); addByte(100);
+    }
+}
+/*SysEx dumps as large as the receive buffer*/
+void buildSysExDump()
+{
+    workloadLength = 0;
+    while (workloadLength + SYS_EX_MAXSIZE <= WORKLOAD_SIZE)
+    {
+        addByte(SystemExclusiveStart);
+        for (uint8_t i = 0; i < SYS_EX_MAXSIZE - 2; i++)
+        {
+            addByte(i & 0x7f);
+        }
+        addByte(SystemExclusiveEnd);
+    }
+}
+
+void addByte(uint8_t data)
+{
+    workload[workloadLength++] = data;
+}
+
+/*Replay the workload without then with callbacks, and print the results*/
+void runWorkload(const __FlashStringHelper *name)
+{
+    uint32_t messages = 0;
+    const uint32_t timeBare = replay(messages);
+
+    benchMIDIInterface.setHandleNoteOn(onNote);
+    benchMIDIInterface.setHandleNoteOff(onNote);
+    benchMIDIInterface.setHandleControlChange(onControlChange);
+    benchMIDIInterface.setHandleClock(onClock);
+    benchMIDIInterface.setHandleSystemExclusive(onSysEx);
+    const uint32_t timeCallback = replay(messages);
+    benchMIDIInterface.disconnectCallbackFromType(NoteOn);
+    benchMIDIInterface.disconnectCallbackFromType(NoteOff);
+    benchMIDIInterface.disconnectCallbackFromType(ControlChange);
+    benchMIDIInterface.disconnectCallbackFromType(Clock);
+    benchMIDIInterface.disconnectCallbackFromType(SystemExclusive);
+
+    benchMIDIInterface.setThru(&thruMIDIInterface);//Each byte is forwarded when it is read
+    const uint32_t timeThru = replay(messages);
+    benchMIDIInterface.setThru(nullptr);
+
+    const uint32_t bytes = (uint32_t)workloadLength * REPEAT;
+    Serial.print(name);
+    Serial.print(F("  ")); Serial.print(bytes);
+    Serial.print(F("  ")); Serial.print(messages);
+    Serial.print(F("  ")); Serial.print(timeBare * 1000.0 / bytes, 1);
+    Serial.print(F("  ")); Serial.print(messages * 1000000.0 / timeBare, 0);
+    Serial.print(F("  ")); Serial.print(((float)timeCallback - timeBare) * 1000.0 / messages, 1);
+    Serial.print(F("  ")); Serial.println(((float)timeThru - timeBare) * 1000.0 / bytes, 1);
+}
+
+/*Return the time in us to parse the workload REPEAT times*/
+uint32_t replay(uint32_t &messages)
+{
+    messages = 0;
+    const uint32_t start = micros();
+    for (uint8_t i = 0; i < REPEAT; i++)
+    {
+        memoryTransport.setInput(workload, workloadLength);
+        thruTransport.clearOutput();
+        while (memoryTransport.available() > 0)
+        {
+            if (benchMIDIInterface.isMIDIMessageOK())
+            {
+                messages++;
+            }
+        }
+    }
+    return micros() - start;
+}
@@ -0,0 +1,130 @@
+/******************************************************************
+File:             MIDI_ClockLatency.ino
+Description:      Measure the Timing Clock latency on a saturated MIDI OUT link,
+                  with direct writes then with the queued transmit mode.
+                  The link is simulated(31250 baud, 64-byte serial buffer) on a
+                  virtual time base, so the results are exact and repeatable.
+Note:             No MIDI device is needed, set the Serial Monitor to 115200 baud
+******************************************************************/
+#include "BMV51M001.h"
+
+#define UART_BUFFER_SIZE    64      //Bytes of the simulated serial port buffer
+#define BYTE_TIME           320     //us per byte at 31250 baud
+#define CLOCK_PERIOD        20833   //us, 24 ppqn at 120 bpm
+#define RUN_TIME            2000000 //us of simulated time per run
+#define STEP_TIME           100     //us between two loop passes
+
+/*MIDI OUT serial port: the bytes leave the buffer one every BYTE_TIME*/
+class SimulatedUart
+{
+public:
+    void begin(unsigned long) { reset(); }
+    int available(void) { return 0; }
+    int read(void) { return -1; }
+    int availableForWrite(void) { return UART_BUFFER_SIZE - count; }
+    size_t write(uint8_t data) { return write(&data, 1); }
+    size_t write(const uint8_t *array, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            while (count == UART_BUFFER_SIZE)
+            {
+                advance(now + BYTE_TIME);//A full buffer blocks the caller
+            }
+            buffer[(head + count++) % UART_BUFFER_SIZE] = array[i];
+        }
+        return length;
+    }
+    /*Shift the bytes out until the given time and check the clock bytes*/
+    void advance(uint32_t until)
+    {
+        while (count != 0 && nextShift <= until)
+        {
+            if (buffer[head] == Clock)
+            {
+                const uint32_t latency = nextShift - clockSent;
+                latencySum += latency;
+                if (latency > latencyMax)
+                {
+                    latencyMax = latency;
+                }
+                clocks++;
+            }
+            head = (head + 1) % UART_BUFFER_SIZE;
+            count--;
+            nextShift += BYTE_TIME;
+        }
+        now = until;
+        if (count == 0)
+        {
+            nextShift = now + BYTE_TIME;
+        }
+    }
+    void reset(void)
+    {
+        head = count = 0;
+        now = 0; nextShift = BYTE_TIME;
+        clockSent = 0; latencySum = 0; latencyMax = 0; clocks = 0;
+    }
+
+    uint32_t now, nextShift, clockSent;
+    uint32_t latencySum, latencyMax, clocks;
+
+private:
+    uint8_t buffer[UART_BUFFER_SIZE];
+    uint8_t head, count;
+};
+
+SimulatedUart uart;
+BasicMidiInterface<SimulatedUart> myMIDIInterface(&uart);
+
+void runLink(bool queued);
+
+void setup()
+{
+    Serial.begin(115200);
+    myMIDIInterface.begin(MIDI_CHANNEL_OFF);
+    Serial.println(F("mode      clocks  avg us  max us"));
+}
+
+void loop()
+{
+    runLink(false);
+    runLink(true);
+    Serial.println();
+    delay(5000);
+}
+
+/*Keep the link saturated with notes and send a clock every CLOCK_PERIOD*/
+void runLink(bool queued)
+{
+    uint32_t nextClock = CLOCK_PERIOD;
+    uint8_t note = 0;
+
+    uart.reset();
+    myMIDIInterface.setTransmitQueue(queued);
+    while (uart.now < RUN_TIME)
+    {
+        //Fill whatever buffer is in use: the serial port or the transmit queue
+        while (queued ? (myMIDIInterface.getTransmitQueueCount() < MIDI_TX_QUEUE_SIZE - 8)
+                      : (uart.availableForWrite() >= 3))
+        {
+            myMIDIInterface.sendNoteOn(36 + note, 100, 1);
+            note = (note + 1) % 48;
+        }
+        if (uart.now >= nextClock)
+        {
+            uart.clockSent = uart.now;
+            myMIDIInterface.sendClock();
+            nextClock += CLOCK_PERIOD;
+        }
+        myMIDIInterface.serviceOutput();
+        uart.advance(uart.now + STEP_TIME);
+    }
+    myMIDIInterface.setTransmitQueue(false);
+
+    Serial.print(queued ? F("queued    ") : F("direct    "));
+    Serial.print(uart.clocks);
+    Serial.print(F("      ")); Serial.print(uart.clocks ? uart.latencySum / uart.clocks : 0);
+    Serial.print(F("     ")); Serial.println(uart.latencyMax);
+}
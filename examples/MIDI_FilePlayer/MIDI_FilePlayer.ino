@@ -0,0 +1,69 @@
+/******************************************************************
+File:             MIDI_FilePlayer.ino
+Description:      Play a Standard MIDI File on the MIDI device connected to
+                  the BMV51M001 module, in a loop. The song is a type 1 file
+                  held in flash: a tempo track and a melody track.
+                  A Song Position Pointer received on the MIDI input moves
+                  the playback, Start/Continue/Stop control it.
+Note:             A file on an SD card is played the same way, with a read
+                  function given to begin():
+                      size_t readFile(void *source, uint32_t position, uint8_t *array, size_t length)
+                      {
+                          File *file = (File *)source;
+                          file->seek(position);
+                          return file->read(array, length);
+                      }
+                      player.begin(&file, readFile);
+******************************************************************/
+#include "BM_MIDIFilePlayer.h"
+
+const uint8_t song[] =
+{
+    'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 2, 0, 96,          //Type 1, 2 tracks, 96 ticks per quarter note
+    'M', 'T', 'r', 'k', 0, 0, 0, 19,
+    0x00, 0xff, 0x51, 3, 0x07, 0xa1, 0x20,                      //120 bpm
+    0x83, 0x00, 0xff, 0x51, 3, 0x06, 0x1a, 0x80,                //1 bar later: 150 bpm
+    0x00, 0xff, 0x2f, 0,
+    'M', 'T', 'r', 'k', 0, 0, 0, 47,
+    0x00, 0xc0, 0,                                              //Piano
+    0x00, 0x90, 60, 100,  0x30, 60, 0,                          //Running status, NoteOn velocity 0 is the NoteOff
+    0x30, 64, 100,  0x30, 64, 0,
+    0x30, 67, 100,  0x30, 67, 0,
+    0x30, 72, 100,  0x81, 0x40, 72, 0,
+    0x60, 0x90, 67, 100,  0x30, 67, 0,
+    0x30, 60, 100,  0x82, 0x00, 60, 0,
+    0x00, 0xff, 0x2f, 0
+};
+
+BMV51M001 myMIDIInterface(&Serial);
+MidiNoteTracker notes;                      //stop() and seek() turn the notes held off
+MidiFilePlayer player(&myMIDIInterface);
+
+void songPosition(uint16_t beats) { player.seekSongPosition(beats); }
+void start(void) { player.seek(0); player.play(); }
+void continueSong(void) { player.play(); }
+void stopSong(void) { player.stop(); }
+
+void setup()
+{
+    myMIDIInterface.begin(MIDI_CHANNEL_OMNI);
+    myMIDIInterface.setNoteTracker(&notes, MIDI_TRACK_SENT);
+    myMIDIInterface.setHandleSongPosition(songPosition);
+    myMIDIInterface.setHandleStart(start);
+    myMIDIInterface.setHandleContinue(continueSong);
+    myMIDIInterface.setHandleStop(stopSong);
+    if (player.begin(song, sizeof(song)))
+    {
+        player.play();
+    }
+}
+
+void loop()
+{
+    myMIDIInterface.isMIDIMessageOK();
+    if (!player.update() && player.isFinished())
+    {
+        delay(1000);
+        start();    //Play the song again
+    }
+}
@@ -0,0 +1,46 @@
+/******************************************************************
+File:             MIDI_Merge.ino
+Description:      Merge the MIDI inputs of two BMV51M001 modules and send
+                  the merged stream to the MIDI device on the first module.
+                  A SysEx is sent whole, the messages of the other input
+                  wait for its end; clock and other real-time bytes pass at once.
+Note:             The statistics are printed on Serial every 5 seconds
+******************************************************************/
+#include "BM_MIDIMerger.h"
+
+BMV51M001 firstMIDIInterface(&Serial);    //Input 1, and output of the merged stream
+BMV51M001 secondMIDIInterface(&Serial4);  //Input 2
+MidiMerger merger(&firstMIDIInterface);
+
+unsigned long lastReport = 0;
+
+void setup()
+{
+    firstMIDIInterface.begin(MIDI_CHANNEL_OMNI);
+    firstMIDIInterface.setRunningStatus(USE_RUNNING_STATUS);    //One status byte for the messages of both inputs
+    secondMIDIInterface.begin(MIDI_CHANNEL_OMNI);
+    merger.addInput(&firstMIDIInterface);
+    merger.addInput(&secondMIDIInterface);
+}
+
+void loop()
+{
+    //Reading the inputs feeds the merger
+    firstMIDIInterface.isMIDIMessageOK();
+    secondMIDIInterface.isMIDIMessageOK();
+    merger.update();    //Release the output if a SysEx stops in the middle
+
+    if (millis() - lastReport >= 5000)
+    {
+        lastReport = millis();
+        for (uint8_t port = 0; port < merger.getInputCount(); port++)
+        {
+            MidiMergerStats stats = merger.getStats(port);
+            Serial.print(F("input ")); Serial.print(port + 1);
+            Serial.print(F(": sent ")); Serial.print(stats.messages);
+            Serial.print(F(" held ")); Serial.print(stats.held);
+            Serial.print(F(" dropped ")); Serial.print(stats.dropped);
+            Serial.print(F(" max queue ")); Serial.println(stats.maxDepth);
+        }
+    }
+}
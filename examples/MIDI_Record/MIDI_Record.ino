@@ -0,0 +1,85 @@
+/******************************************************************
+File:             MIDI_Record.ino
+Description:      Record the MIDI messages received by the BMV51M001 module
+                  for 10 seconds into a MIDI file in RAM, then play the file
+                  back on the MIDI device connected to the module.
+Note:             The recorder statistics are printed on Serial(115200 baud).
+                  A file on an SD card is written the same way, with a write
+                  function given to begin():
+                      size_t writeFile(void *sink, uint32_t position, const uint8_t *array, size_t length)
+                      {
+                          File *file = (File *)sink;
+                          file->seek(position);
+                          return file->write(array, length);
+                      }
+                      recorder.begin(&file, writeFile);
+******************************************************************/
+#include "BM_MIDIFilePlayer.h"
+
+#define FILE_SIZE       4096    //Bytes of the MIDI file in RAM
+#define RECORD_TIME     10000   //ms
+
+uint8_t song[FILE_SIZE];
+uint32_t songSize = 0;
+
+BMV51M001 myMIDIInterface(&Serial4);
+MidiFileRecorder recorder;
+MidiFilePlayer player(&myMIDIInterface);
+unsigned long recordStart;
+
+/*Sink of the recorder: the file in RAM*/
+size_t writeSong(void *sink, uint32_t position, const uint8_t *array, size_t length)
+{
+    (void)sink;
+    if (position >= FILE_SIZE)
+    {
+        return 0;//Full: the recorder drops the next events
+    }
+    if (length > FILE_SIZE - position)
+    {
+        length = FILE_SIZE - position;
+    }
+    memcpy(song + position, array, length);
+    if (position + length > songSize)
+    {
+        songSize = position + length;
+    }
+    return length;
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    myMIDIInterface.begin(MIDI_CHANNEL_OMNI);
+    myMIDIInterface.setTimestamp(true);         //Events timed from the arrival of their status byte
+    myMIDIInterface.setRecorder(&recorder);
+    recorder.begin(nullptr, writeSong);
+    recordStart = millis();
+    Serial.println(F("recording..."));
+}
+
+void loop()
+{
+    myMIDIInterface.isMIDIMessageOK();
+    if (recorder.isRecording())
+    {
+        recorder.update();  //The full buffer is written here, never while receiving
+        if (millis() - recordStart >= RECORD_TIME)
+        {
+            recorder.end();
+            MidiRecorderStats stats = recorder.getStats();
+            Serial.print(F("events ")); Serial.print(stats.events);
+            Serial.print(F(" dropped ")); Serial.print(stats.dropped);
+            Serial.print(F(" bytes ")); Serial.print(stats.bytesWritten);
+            Serial.print(F(" max buffered ")); Serial.println(stats.maxBuffered);
+            if (player.begin(song, songSize))
+            {
+                player.play();
+            }
+        }
+    }
+    else
+    {
+        player.update();
+    }
+}
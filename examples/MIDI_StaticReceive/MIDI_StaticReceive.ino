@@ -0,0 +1,36 @@
+/******************************************************************
+File:             MIDI_StaticReceive.ino
+Description:      Receive MIDI Messages by MIDI Interface Module(BMV51M001)
+                  and switch led, with compile-time handlers: only the
+                  NoteOn/NoteOff code is linked, SysEx and real-time
+                  support are compiled out
+Note:             -       
+******************************************************************/
+#include "BM_MIDIStatic.h"
+
+struct LedHandlers : MidiDefaultHandlers
+{
+    static constexpr bool useSysEx = false;     //No SysEx buffer
+    static constexpr bool useRealTime = false;  //Clock, Start... are ignored
+
+    static void noteOn(uint8_t, uint8_t, uint8_t velocity)
+    {
+        digitalWrite(LED_BUILTIN, velocity ? HIGH : LOW);   //LED on(NoteOn with 0 velocity:off)
+    }
+    static void noteOff(uint8_t, uint8_t, uint8_t)
+    {
+        digitalWrite(LED_BUILTIN, LOW);   //LED off
+    }
+};
+
+MidiStaticInterface<HardwareSerial, LedHandlers> myMIDIInterface(&Serial);
+
+void setup() 
+{
+    pinMode(LED_BUILTIN, OUTPUT);   //LED initial
+    myMIDIInterface.begin();  //Interface initial
+}
+void loop() 
+{
+    myMIDIInterface.isMIDIMessageOK();  //The handlers are called from here
+}
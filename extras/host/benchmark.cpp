@@ -0,0 +1,473 @@
+/*************************************************************************
+File:       	  benchmark.cpp
+Author:          BESTMODULES
+Description:    Host build of examples/MIDI_Benchmark: the same workloads are
+                replayed from RAM through MidiMemoryTransport, and the receive
+                path(parse + inputFilter + launchCallback) and the soft thru
+                are timed with the host steady clock: each time is the minimum
+                of BENCH_RUNS runs after a warm-up run. The parser is also
+                compared with the switch-based parse() it replaced.
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include "BMV51M001.h"
+#include "BM_MIDITransport.h"
+
+#define WORKLOAD_SIZE   512   //Bytes of each workload
+#define BENCH_RUNS      5     //Runs of each measure, the minimum is kept
+
+static MidiMemoryTransport memoryTransport;
+static BasicMidiInterface<MidiMemoryTransport> benchMIDIInterface(&memoryTransport);
+
+static uint8_t workload[WORKLOAD_SIZE];
+static uint8_t thruOutput[WORKLOAD_SIZE];
+static MidiMemoryTransport thruTransport(thruOutput, sizeof(thruOutput));
+static BasicMidiInterface<MidiMemoryTransport> thruMIDIInterface(&thruTransport);
+static uint16_t workloadLength = 0;
+static unsigned repeat = 20000;//Replays of each workload
+static volatile uint32_t callbackCount = 0;
+
+static void onNote(uint8_t, uint8_t, uint8_t) { callbackCount++; }
+static void onControlChange(uint8_t, uint8_t, uint8_t) { callbackCount++; }
+static void onClock(void) { callbackCount++; }
+static void onSysEx(uint8_t *, uint16_t) { callbackCount++; }
+static void onData(uint8_t, uint8_t) { callbackCount++; }
+static void onPitchBend(uint8_t, int16_t) { callbackCount++; }
+static void onByte(uint8_t) { callbackCount++; }
+static void onWord(uint16_t) { callbackCount++; }
+
+static void addByte(uint8_t data)
+{
+    workload[workloadLength++] = data;
+}
+
+/*6-note chords on and off, a status byte for every message*/
+static void buildChords()
+{
+    workloadLength = 0;
+    while (workloadLength + 6 <= WORKLOAD_SIZE)
+    {
+        uint8_t note = 48 + (workloadLength / 6) % 24;
+        addByte(NoteOn);  addByte(note); addByte(100);
+        addByte(NoteOff); addByte(note); addByte(0);
+    }
+}
+/*Modulation wheel sweep on channel 1 with running status*/
+static void buildControlSweep()
+{
+    workloadLength = 0;
+    addByte(ControlChange);
+    for (uint8_t value = 0; workloadLength + 2 <= WORKLOAD_SIZE; value++)
+    {
+        addByte(ModulationWheel); addByte(value & 0x7f);
+    }
+}
+/*Notes on channel 2 sent with running status(NoteOn with 0 velocity as NoteOff)*/
+static void buildRunningStatus()
+{
+    workloadLength = 0;
+    addByte(NoteOn | 1);
+    for (uint8_t note = 0; workloadLength + 4 <= WORKLOAD_SIZE; note++)
+    {
+        addByte(note & 0x7f); addByte(90);
+        addByte(note & 0x7f); addByte(0);
+    }
+}
+/*Timing Clock interleaved inside note messages*/
+static void buildClockInterleave()
+{
+    workloadLength = 0;
+    while (workloadLength + 5 <= WORKLOAD_SIZE)
+    {
+        addByte(NoteOn); addByte(Clock); addByte(60); addByte(Clock); addByte(100);
+    }
+}
+/*SysEx dumps as large as the receive buffer*/
+static void buildSysExDump()
+{
+    workloadLength = 0;
+    while (workloadLength + SYS_EX_MAXSIZE <= WORKLOAD_SIZE)
+    {
+        addByte(SystemExclusiveStart);
+        for (uint8_t i = 0; i < SYS_EX_MAXSIZE - 2; i++)
+        {
+            addByte(i & 0x7f);
+        }
+        addByte(SystemExclusiveEnd);
+    }
+}
+
+/*The parse() of the library before the status table(a switch on each status byte),
+  kept as the reference of the parser comparison. Same decoding on well-formed input.*/
+struct ReferenceParser{
+    uint8_t pendingMessage[3];
+    uint8_t pendingIndex;
+    uint8_t databytes;
+    uint8_t runningStatus;
+    uint8_t sysExArray[SYS_EX_MAXSIZE];
+    MidiType type;
+    uint8_t channel;
+    uint8_t data1;
+    uint8_t data2;
+
+    void reset(void)
+    {
+        databytes = 0;
+        pendingIndex = 0;
+        runningStatus = InvalidType;
+    }
+    static MidiType typeFromStatus(uint8_t status)
+    {
+        if (status < 0x80 || status == Undefined_F4 || status == Undefined_F5 || status == Undefined_FD)
+        {
+            return InvalidType;
+        }
+        return (status < 0xf0) ? MidiType(status & 0xf0) : MidiType(status);
+    }
+    static bool isChannel(MidiType type)
+    {
+        return type == NoteOff || type == NoteOn || type == ControlChange || type == AfterTouchPoly
+            || type == AfterTouchChannel || type == PitchBend || type == ProgramChange;
+    }
+    //One byte of the transport, true when a message is complete
+    bool parse(MidiMemoryTransport &serial)
+    {
+        if (serial.available() == 0)
+        {
+            return false;
+        }
+        const uint8_t extracted = uint8_t(serial.read());
+        if (extracted == Undefined_FD)
+        {
+            return false;
+        }
+        if (pendingIndex == 0)
+        {
+            pendingMessage[0] = extracted;
+            if (isChannel(typeFromStatus(runningStatus)) && extracted < 0x80)
+            {
+                pendingMessage[0] = runningStatus;
+                pendingMessage[1] = extracted;
+                pendingIndex = 1;
+            }
+            const MidiType pendingType = typeFromStatus(pendingMessage[0]);
+            switch (pendingType)
+            {
+                case Start: case Continue: case Stop: case Clock:
+                case ActiveSensing: case SystemReset: case TuneRequest:
+                    type = pendingType;
+                    channel = 0;
+                    data1 = 0;
+                    data2 = 0;
+                    pendingIndex = 0;
+                    databytes = 0;
+                    return true;
+                case ProgramChange: case AfterTouchChannel: case TimeCodeQuarterFrame: case SongSelect:
+                    databytes = 1;
+                    break;
+                case NoteOn: case NoteOff: case ControlChange: case PitchBend:
+                case AfterTouchPoly: case SongPosition:
+                    databytes = 2;
+                    break;
+                case SystemExclusiveStart: case SystemExclusiveEnd:
+                    databytes = SYS_EX_MAXSIZE - 1;
+                    runningStatus = InvalidType;
+                    sysExArray[0] = pendingType;
+                    break;
+                default:
+                    reset();
+                    return false;
+            }
+            if (pendingIndex >= databytes)
+            {
+                type = pendingType;
+                channel = uint8_t((pendingMessage[0] & 0x0f) + 1);
+                data1 = pendingMessage[1];
+                data2 = 0;
+                pendingIndex = 0;
+                databytes = 0;
+                return true;
+            }
+            pendingIndex++;
+            return false;
+        }
+        if (extracted >= 0x80)
+        {
+            switch (extracted)
+            {
+                case Clock: case Start: case Continue: case Stop: case ActiveSensing: case SystemReset:
+                    type = MidiType(extracted);//The pending message is left as is
+                    channel = 0;
+                    data1 = 0;
+                    data2 = 0;
+                    return true;
+                case SystemExclusiveStart: case SystemExclusiveEnd:
+                    if (sysExArray[0] == SystemExclusiveStart || sysExArray[0] == SystemExclusiveEnd)
+                    {
+                        sysExArray[pendingIndex++] = extracted;
+                        type = SystemExclusive;
+                        data1 = pendingIndex & 0xff;
+                        data2 = uint8_t(pendingIndex >> 8);
+                        channel = 0;
+                        reset();
+                        return true;
+                    }
+                    reset();
+                    return false;
+                default:
+                    break;
+            }
+        }
+        if (pendingMessage[0] == SystemExclusiveStart || pendingMessage[0] == SystemExclusiveEnd)
+        {
+            sysExArray[pendingIndex] = extracted;
+        }
+        else
+        {
+            pendingMessage[pendingIndex] = extracted;
+        }
+        if (pendingIndex < databytes)
+        {
+            pendingIndex++;
+            return false;
+        }
+        if (pendingMessage[0] == SystemExclusiveStart || pendingMessage[0] == SystemExclusiveEnd)
+        {
+            //SysEx larger than the buffer: split(the callback launched here is not modelled)
+            const uint8_t lastByte = sysExArray[SYS_EX_MAXSIZE - 1];
+            sysExArray[0] = SystemExclusiveEnd;
+            sysExArray[1] = lastByte;
+            pendingIndex = 2;
+            return false;
+        }
+        type = typeFromStatus(pendingMessage[0]);
+        channel = isChannel(type) ? uint8_t((pendingMessage[0] & 0x0f) + 1) : 0;
+        data1 = pendingMessage[1];
+        data2 = (databytes == 2) ? pendingMessage[2] : 0;
+        pendingIndex = 0;
+        databytes = 0;
+        runningStatus = isChannel(type) ? pendingMessage[0] : uint8_t(InvalidType);
+        return true;
+    }
+};
+static ReferenceParser referenceParser;
+
+/*The interface with its parser callable alone(same transport as the benchmark interface)*/
+struct ParserInterface : BasicMidiInterface<MidiMemoryTransport>{
+    ParserInterface(MidiMemoryTransport *theTransport) : BasicMidiInterface<MidiMemoryTransport>(theTransport) {}
+    using MidiInterfaceCore::parseByte;
+};
+static ParserInterface parserMIDIInterface(&memoryTransport);
+
+/*Return the time in ns to parse the workload repeat times*/
+static double replayOnce(uint32_t &messages)
+{
+    messages = 0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeat; i++)
+    {
+        memoryTransport.setInput(workload, workloadLength);
+        thruTransport.clearOutput();
+        while (memoryTransport.available() > 0)
+        {
+            if (benchMIDIInterface.isMIDIMessageOK())
+            {
+                messages++;
+            }
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+/*Replay through the parser of the library alone(parseByte(), no filter or callback)*/
+static double replayParserOnce(uint32_t &messages)
+{
+    messages = 0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeat; i++)
+    {
+        memoryTransport.setInput(workload, workloadLength);
+        while (memoryTransport.available() > 0)
+        {
+            if (parserMIDIInterface.parseByte(uint8_t(memoryTransport.read())))
+            {
+                messages++;
+            }
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+/*Same replay through the reference parser*/
+static double replayReferenceOnce(uint32_t &messages)
+{
+    messages = 0;
+    referenceParser.reset();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < repeat; i++)
+    {
+        memoryTransport.setInput(workload, workloadLength);
+        while (memoryTransport.available() > 0)
+        {
+            if (referenceParser.parse(memoryTransport))
+            {
+                messages++;
+            }
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+/*Warm up(caches, branch predictors, CPU clock), then return the fastest of BENCH_RUNS replays*/
+static double replay(uint32_t &messages, double (*replayFunction)(uint32_t &) = replayOnce)
+{
+    double best = replayFunction(messages);
+    for (uint8_t run = 0; run < BENCH_RUNS; run++)
+    {
+        const double time = replayFunction(messages);
+        best = (run == 0 || time < best) ? time : best;
+    }
+    return best;
+}
+/*Cost of the callbacks per message: a difference below the clock resolution is 0*/
+static double callbackCost(double timeCallback, double timeBare, uint32_t messages)
+{
+    return (messages != 0 && timeCallback > timeBare) ? (timeCallback - timeBare) / messages : 0.0;
+}
+
+/*Replay the workload without then with callbacks, then through the thru, and print the results*/
+static void runWorkload(const char *name)
+{
+    uint32_t messages = 0;
+    const double timeBare = replay(messages);
+
+    benchMIDIInterface.setHandleNoteOn(onNote);
+    benchMIDIInterface.setHandleNoteOff(onNote);
+    benchMIDIInterface.setHandleControlChange(onControlChange);
+    benchMIDIInterface.setHandleClock(onClock);
+    benchMIDIInterface.setHandleSystemExclusive(onSysEx);
+    const double timeCallback = replay(messages);
+    benchMIDIInterface.disconnectCallbackFromType(NoteOn);
+    benchMIDIInterface.disconnectCallbackFromType(NoteOff);
+    benchMIDIInterface.disconnectCallbackFromType(ControlChange);
+    benchMIDIInterface.disconnectCallbackFromType(Clock);
+    benchMIDIInterface.disconnectCallbackFromType(SystemExclusive);
+
+    benchMIDIInterface.setThru(&thruMIDIInterface);//Each byte is forwarded when it is read
+    const double timeThru = replay(messages);
+    benchMIDIInterface.setThru(nullptr);
+
+    const double bytes = double(workloadLength) * repeat;
+    printf("%s  %8.0f  %8lu  %7.2f  %10.0f  %15.2f  %12.2f\n", name, bytes, (unsigned long)messages,
+           timeBare / bytes, messages * 1e9 / timeBare,
+           callbackCost(timeCallback, timeBare, messages), (timeThru > timeBare) ? (timeThru - timeBare) / bytes : 0.0);
+}
+
+/*One message of each type, a status byte for every message*/
+struct TypeWorkload{
+    MidiType type;
+    const char *name;
+    uint8_t size;
+    uint8_t bytes[3];
+};
+static const TypeWorkload typeWorkloads[] = {
+    {NoteOff,              "NoteOff          ", 3, {NoteOff, 60, 0}},
+    {NoteOn,               "NoteOn           ", 3, {NoteOn, 60, 100}},
+    {AfterTouchPoly,       "AfterTouchPoly   ", 3, {AfterTouchPoly, 60, 50}},
+    {ControlChange,        "ControlChange    ", 3, {ControlChange, ModulationWheel, 64}},
+    {ProgramChange,        "ProgramChange    ", 2, {ProgramChange, 5}},
+    {AfterTouchChannel,    "AfterTouchChannel", 2, {AfterTouchChannel, 50}},
+    {PitchBend,            "PitchBend        ", 3, {PitchBend, 0x00, 0x40}},
+    {TimeCodeQuarterFrame, "TimeCodeQuarter  ", 2, {TimeCodeQuarterFrame, 0x10}},
+    {SongPosition,         "SongPosition     ", 3, {SongPosition, 0x10, 0x00}},
+    {SongSelect,           "SongSelect       ", 2, {SongSelect, 3}},
+    {TuneRequest,          "TuneRequest      ", 1, {TuneRequest}},
+    {Clock,                "Clock            ", 1, {Clock}},
+    {Start,                "Start            ", 1, {Start}},
+    {ActiveSensing,        "ActiveSensing    ", 1, {ActiveSensing}},
+};
+
+/*Connect the typed callback of a type*/
+static void connectType(MidiType type)
+{
+    switch (type)
+    {
+        case NoteOff:              benchMIDIInterface.setHandleNoteOff(onNote); break;
+        case NoteOn:               benchMIDIInterface.setHandleNoteOn(onNote); break;
+        case AfterTouchPoly:       benchMIDIInterface.setHandleAfterTouchPoly(onNote); break;
+        case ControlChange:        benchMIDIInterface.setHandleControlChange(onControlChange); break;
+        case ProgramChange:        benchMIDIInterface.setHandleProgramChange(onData); break;
+        case AfterTouchChannel:    benchMIDIInterface.setHandleAfterTouchChannel(onData); break;
+        case PitchBend:            benchMIDIInterface.setHandlePitchBend(onPitchBend); break;
+        case TimeCodeQuarterFrame: benchMIDIInterface.setHandleTimeCodeQuarterFrame(onByte); break;
+        case SongPosition:         benchMIDIInterface.setHandleSongPosition(onWord); break;
+        case SongSelect:           benchMIDIInterface.setHandleSongSelect(onByte); break;
+        case TuneRequest:          benchMIDIInterface.setHandleTuneRequest(onClock); break;
+        case Clock:                benchMIDIInterface.setHandleClock(onClock); break;
+        case Start:                benchMIDIInterface.setHandleStart(onClock); break;
+        case ActiveSensing:        benchMIDIInterface.setHandleActiveSensing(onClock); break;
+        default: break;
+    }
+}
+
+/*Replay messages of one type without then with its callback, and print the cost per message*/
+static void runType(const TypeWorkload &typeWorkload)
+{
+    workloadLength = 0;
+    while (workloadLength + typeWorkload.size <= WORKLOAD_SIZE)
+    {
+        for (uint8_t i = 0; i < typeWorkload.size; i++)
+        {
+            addByte(typeWorkload.bytes[i]);
+        }
+    }
+    uint32_t messages = 0;
+    const double timeBare = replay(messages);
+    connectType(typeWorkload.type);
+    const double timeCallback = replay(messages);
+    benchMIDIInterface.disconnectCallbackFromType(typeWorkload.type);
+    printf("%s  %8lu  %10.2f  %15.2f\n", typeWorkload.name, (unsigned long)messages,
+           (messages != 0) ? timeBare / messages : 0.0, callbackCost(timeCallback, timeBare, messages));
+}
+
+/*Parse the workload with the parser of the library and with the reference parser, print both*/
+static void runParser(const char *name)
+{
+    uint32_t messages = 0;
+    uint32_t referenceMessages = 0;
+    const double timeTable = replay(messages, replayParserOnce);
+    const double timeSwitch = replay(referenceMessages, replayReferenceOnce);
+    const double bytes = double(workloadLength) * repeat;
+    printf("%s  %13.2f  %14.2f  %8lu%s\n", name, timeTable / bytes, timeSwitch / bytes, (unsigned long)messages,
+           (messages == referenceMessages) ? "" : "  message count differs");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+    {
+        repeat = (unsigned)strtoul(argv[1], nullptr, 0);//benchmark [repeat]
+    }
+    benchMIDIInterface.begin(MIDI_CHANNEL_OMNI);
+    thruMIDIInterface.begin(MIDI_CHANNEL_OFF);
+    parserMIDIInterface.begin(MIDI_CHANNEL_OMNI);
+    printf("workload           bytes      msgs  ns/byte      msgs/s  callback ns/msg  thru ns/byte\n");
+    buildChords();          runWorkload("note chords   ");
+    buildControlSweep();    runWorkload("CC sweep      ");
+    buildRunningStatus();   runWorkload("running status");
+    buildClockInterleave(); runWorkload("clock + notes ");
+    buildSysExDump();       runWorkload("SysEx dump    ");
+    printf("\ntype                   msgs      ns/msg  callback ns/msg\n");
+    for (uint8_t i = 0; i < sizeof(typeWorkloads) / sizeof(typeWorkloads[0]); i++)
+    {
+        runType(typeWorkloads[i]);
+    }
+    printf("\nparser          table ns/byte  switch ns/byte      msgs\n");
+    buildChords();          runParser("note chords   ");
+    buildControlSweep();    runParser("CC sweep      ");
+    buildRunningStatus();   runParser("running status");
+    buildClockInterleave(); runParser("clock + notes ");
+    buildSysExDump();       runParser("SysEx dump    ");
+    return 0;
+}
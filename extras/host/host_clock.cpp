@@ -0,0 +1,45 @@
+/*************************************************************************
+File:       	  host_clock.cpp
+Author:          BESTMODULES
+Description:    Time base of the host build(see BM_MIDIDefine.h)
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include <chrono>
+#include "host_clock.h"
+
+static bool sManual = false;
+static unsigned long sManualTime = 0;
+
+static unsigned long hostMicros(void)
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned long micros(void)
+{
+    return sManual ? sManualTime : hostMicros();
+}
+
+unsigned long millis(void)
+{
+    return micros() / 1000;
+}
+
+void hostClockSet(unsigned long us)
+{
+    sManual = true;
+    sManualTime = us;
+}
+
+void hostClockAdvance(unsigned long us)
+{
+    sManualTime += us;
+}
+
+void hostClockReal(void)
+{
+    sManual = false;
+}
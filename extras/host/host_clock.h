@@ -0,0 +1,20 @@
+/***************************************************************************
+File:       		host_clock.h
+Author:           BESTMODULE
+Description:      micros() and millis() of the host build: the steady clock
+                  of the host, or a manual clock the tests move themselves
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；g++ -std=c++11
+
+****************************************************************************/
+#ifndef _HOST_CLOCK_H
+#define _HOST_CLOCK_H
+
+//micros() and millis() return the manual time from now on(us)
+void hostClockSet(unsigned long us);
+//Move the manual time forward(us)
+void hostClockAdvance(unsigned long us);
+//micros() and millis() follow the host steady clock again(default)
+void hostClockReal(void);
+
+#endif
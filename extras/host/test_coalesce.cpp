@@ -0,0 +1,62 @@
+/*************************************************************************
+File:       	  test_coalesce.cpp
+Author:          BESTMODULES
+Description:    Input coalescing in interrupt mode: an outdated controller
+                value is skipped, but not the pedals, and not across a note
+                or a Program Change of its channel
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include "test_util.h"
+
+static TestPort port;
+static BasicMidiInterface<MidiMemoryTransport> &midi = port.midi;
+
+/*Queue the bytes in interrupt mode, then return the messages delivered as bytes*/
+static std::vector<uint8_t> deliver(const std::vector<uint8_t> &bytes)
+{
+    port.transport.setInput(bytes.data(), bytes.size());
+    midi.serviceInput();
+    std::vector<uint8_t> delivered;
+    while (midi.isMIDIMessageOK())
+    {
+        delivered.push_back(uint8_t(midi.getMessageType() | (midi.getMessageChannel() - 1)));
+        delivered.push_back(midi.getMessageData1());
+        if (midi.getMessageType() != ProgramChange)
+        {
+            delivered.push_back(midi.getMessageData2());
+        }
+    }
+    return delivered;
+}
+
+int main(void)
+{
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.setInterruptMode(true);
+    midi.setInputCoalescing(true);
+
+    //Outdated values of a controller are skipped, the last one is delivered
+    CHECK(deliver({0xb0, ChannelVolume, 10, 0xb0, ChannelVolume, 20, 0xb0, ChannelVolume, 30})
+          == std::vector<uint8_t>({0xb0, ChannelVolume, 30}));
+    CHECK(midi.getCoalescedCount() == 2);
+
+    //Sustain off, note off, sustain on: the note is released
+    CHECK(deliver({0xb0, Sustain, 0, 0x80, 60, 0, 0xb0, Sustain, 127})
+          == std::vector<uint8_t>({0xb0, Sustain, 0, 0x80, 60, 0, 0xb0, Sustain, 127}));
+    //The pedals are states: every change is delivered
+    CHECK(deliver({0xb0, Sostenuto, 127, 0xb0, Sostenuto, 0})
+          == std::vector<uint8_t>({0xb0, Sostenuto, 127, 0xb0, Sostenuto, 0}));
+    //A value is delivered before a note or a Program Change of its channel...
+    CHECK(deliver({0xb0, ExpressionController, 10, 0x90, 60, 100, 0xb0, ExpressionController, 20})
+          == std::vector<uint8_t>({0xb0, ExpressionController, 10, 0x90, 60, 100, 0xb0, ExpressionController, 20}));
+    CHECK(deliver({0xe0, 0x00, 0x10, 0xc0, 5, 0xe0, 0x00, 0x20})
+          == std::vector<uint8_t>({0xe0, 0x00, 0x10, 0xc0, 5, 0xe0, 0x00, 0x20}));
+    //...but not before a note of another channel
+    CHECK(deliver({0xb0, ExpressionController, 10, 0x91, 60, 100, 0xb0, ExpressionController, 20})
+          == std::vector<uint8_t>({0x91, 60, 100, 0xb0, ExpressionController, 20}));
+    CHECK(midi.getCoalescedCount() == 3);
+
+    return testResult("test_coalesce");
+}
@@ -0,0 +1,52 @@
+/*************************************************************************
+File:       	  test_controller_cache.cpp
+Author:          BESTMODULES
+Description:    MidiControllerCache on the send path: repeated values are
+                dropped, except an LSB after a new MSB and a Program Change
+                after a new Bank Select
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include "test_util.h"
+
+static TestPort port;
+static BasicMidiInterface<MidiMemoryTransport> &midi = port.midi;
+static MidiControllerCache cache;
+
+int main(void)
+{
+    midi.begin(MIDI_CHANNEL_OFF);
+    midi.setControllerCache(&cache);
+
+    //Plain controller: the repeated value is dropped
+    midi.sendControlChange(Pan, 10, 1);
+    midi.sendControlChange(Pan, 10, 1);
+    CHECK(port.sent({0xb0, Pan, 10}));
+
+    //14-bit controller: the LSB is sent again after a new MSB
+    midi.sendControlChange(ChannelVolume, 10, 1);
+    midi.sendControlChange(ChannelVolume + 32, 5, 1);
+    midi.sendControlChange(ChannelVolume, 11, 1);
+    midi.sendControlChange(ChannelVolume + 32, 5, 1);
+    midi.sendControlChange(ChannelVolume + 32, 5, 1);
+    CHECK(port.sent({0xb0, ChannelVolume, 10, 0xb0, ChannelVolume + 32, 5, 0xb0, ChannelVolume, 11, 0xb0, ChannelVolume + 32, 5}));
+    //A repeated MSB is dropped and keeps the LSB
+    midi.sendControlChange(ChannelVolume, 11, 1);
+    midi.sendControlChange(ChannelVolume + 32, 5, 1);
+    CHECK(port.sent({}));
+
+    //Program Change: sent again after a new Bank Select(MSB or LSB)
+    midi.sendProgramChange(3, 2);
+    midi.sendProgramChange(3, 2);
+    midi.sendControlChange(BankSelect, 1, 2);
+    midi.sendProgramChange(3, 2);
+    midi.sendControlChange(BankSelect + 32, 4, 2);
+    midi.sendProgramChange(3, 2);
+    midi.sendControlChange(BankSelect, 1, 2);
+    midi.sendControlChange(BankSelect + 32, 4, 2);
+    midi.sendProgramChange(3, 2);
+    CHECK(port.sent({0xc1, 3, 0xb1, BankSelect, 1, 0xc1, 3, 0xb1, BankSelect + 32, 4, 0xc1, 3}));
+
+    return testResult("test_controller_cache");
+}
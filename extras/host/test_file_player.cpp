@@ -0,0 +1,255 @@
+/*************************************************************************
+File:       	  test_file_player.cpp
+Author:          BESTMODULES
+Description:    MidiFilePlayer against a reference decode of a random type 1
+                file(4 tracks, tempo changes, running status, SysEx): the bytes
+                sent are the reference bytes and each event goes out within one
+                update() step of its time, from the start and after each seek.
+                A seek sends the program, controllers and pitch bend it skipped.
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include <algorithm>
+#include "BM_MIDIFilePlayer.h"
+#include "test_util.h"
+#include "host_clock.h"
+
+#define TRACKS      4
+#define DIVISION    480
+#define STEP        100     //us between two update() calls
+
+/*Event of the reference decode*/
+struct ReferenceEvent{
+    uint32_t tick;
+    uint32_t time;              // us from the start of the song
+    uint8_t track;
+    uint32_t order;             // position in the track
+    std::vector<uint8_t> bytes; // bytes expected on the wire
+};
+
+static uint32_t seed = 12345;
+static uint32_t random(uint32_t range)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) % range;
+}
+
+static void putVariable(std::vector<uint8_t> &data, uint32_t value)
+{
+    uint8_t bytes[4];
+    int count = 0;
+    do
+    {
+        bytes[count++] = value & 0x7f;
+        value >>= 7;
+    } while (value != 0);
+    while (count-- > 0)
+    {
+        data.push_back(bytes[count] | (count != 0 ? 0x80 : 0));
+    }
+}
+
+static void putLength(std::vector<uint8_t> &file, size_t at, uint32_t length)
+{
+    file[at] = uint8_t(length >> 24);
+    file[at + 1] = uint8_t(length >> 16);
+    file[at + 2] = uint8_t(length >> 8);
+    file[at + 3] = uint8_t(length);
+}
+
+/*Random file, the events of each track are also listed with their tick*/
+static std::vector<uint8_t> buildFile(std::vector<ReferenceEvent> &events, std::vector<std::pair<uint32_t, uint32_t> > &tempos)
+{
+    const uint8_t header[] = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, TRACKS, DIVISION >> 8, DIVISION & 0xff};
+    std::vector<uint8_t> file(header, header + sizeof(header));
+    for (uint8_t track = 0; track < TRACKS; track++)
+    {
+        const size_t start = file.size();
+        const uint8_t chunk[] = {'M', 'T', 'r', 'k', 0, 0, 0, 0};
+        file.insert(file.end(), chunk, chunk + sizeof(chunk));
+        std::vector<uint8_t> data;
+        uint32_t tick = 0;
+        uint8_t status = 0;
+        for (uint32_t order = 0; order < 300; order++)
+        {
+            const uint32_t delta = (random(4) == 0) ? 0 : random(DIVISION);
+            tick += delta;
+            putVariable(data, delta);
+            ReferenceEvent event;
+            event.tick = tick;
+            event.track = track;
+            event.order = order;
+            const uint32_t kind = random(20);
+            if (track == 0 && kind < 3)
+            {
+                const uint32_t tempo = 300000 + random(400000);
+                const uint8_t meta[] = {0xff, 0x51, 3, uint8_t(tempo >> 16), uint8_t(tempo >> 8), uint8_t(tempo)};
+                data.insert(data.end(), meta, meta + sizeof(meta));
+                tempos.push_back(std::make_pair(tick, tempo));
+                status = 0;
+                continue;
+            }
+            if (kind == 3)
+            {
+                const uint32_t length = 1 + random(40);
+                data.push_back(SystemExclusiveStart);
+                putVariable(data, length);
+                event.bytes.push_back(SystemExclusiveStart);
+                for (uint32_t i = 0; i + 1 < length; i++)
+                {
+                    const uint8_t value = uint8_t(random(128));
+                    data.push_back(value);
+                    event.bytes.push_back(value);
+                }
+                data.push_back(SystemExclusiveEnd);
+                event.bytes.push_back(SystemExclusiveEnd);
+                status = 0;
+                events.push_back(event);
+                continue;
+            }
+            const uint8_t type = (kind < 14) ? NoteOn : (kind < 16) ? NoteOff : (kind < 18) ? ControlChange : ProgramChange;
+            const uint8_t eventStatus = uint8_t(type | (track * 3 + random(2)));
+            const uint8_t data1 = uint8_t(random(128));
+            const uint8_t data2 = uint8_t(random(128));
+            if (eventStatus != status)
+            {
+                data.push_back(eventStatus);//Else running status
+                status = eventStatus;
+            }
+            data.push_back(data1);
+            event.bytes.push_back(eventStatus);
+            event.bytes.push_back(data1);
+            if (type != ProgramChange)
+            {
+                data.push_back(data2);
+                event.bytes.push_back(data2);
+            }
+            events.push_back(event);
+        }
+        const uint8_t endOfTrack[] = {0, 0xff, 0x2f, 0};
+        data.insert(data.end(), endOfTrack, endOfTrack + sizeof(endOfTrack));
+        file.insert(file.end(), data.begin(), data.end());
+        putLength(file, start + 4, uint32_t(data.size()));
+    }
+    return file;
+}
+
+/*Reference timing: the tempo map applied to the ticks, in the order the events are played*/
+static void decodeTimes(std::vector<ReferenceEvent> &events, const std::vector<std::pair<uint32_t, uint32_t> > &tempos)
+{
+    std::stable_sort(events.begin(), events.end(), [](const ReferenceEvent &a, const ReferenceEvent &b)
+    {
+        return (a.tick != b.tick) ? a.tick < b.tick : (a.track != b.track) ? a.track < b.track : a.order < b.order;
+    });
+    for (ReferenceEvent &event : events)
+    {
+        uint32_t anchorTick = 0;
+        uint32_t anchorTime = 0;
+        uint32_t tempo = MIDI_FILE_DEFAULT_TEMPO;
+        for (const std::pair<uint32_t, uint32_t> &change : tempos)
+        {
+            if (change.first > event.tick)
+            {
+                break;
+            }
+            anchorTime += uint32_t(uint64_t(change.first - anchorTick) * tempo / DIVISION);
+            anchorTick = change.first;
+            tempo = change.second;
+        }
+        event.time = anchorTime + uint32_t(uint64_t(event.tick - anchorTick) * tempo / DIVISION);
+    }
+}
+
+static uint8_t output[1 << 16];
+static MidiMemoryTransport transport(output, sizeof(output));
+static BasicMidiInterface<MidiMemoryTransport> midi(&transport);
+static MidiFilePlayer player(&midi);
+
+/*Play from the current position: the events from first on are checked byte by byte,
+  each must be sent in the update() step that reaches its time*/
+static void playAndCheck(const std::vector<ReferenceEvent> &events, size_t first, unsigned long clock)
+{
+    transport.clearOutput();
+    hostClockSet(clock);
+    player.play();
+    size_t next = first;
+    size_t offset = 0;
+    while (player.update())
+    {
+        hostClockAdvance(STEP);
+        const uint32_t songTime = player.getSongTime() - STEP;//Time of the update() above
+        while (next < events.size() && offset + events[next].bytes.size() <= transport.getOutputLength())
+        {
+            const ReferenceEvent &event = events[next];
+            CHECK(std::equal(event.bytes.begin(), event.bytes.end(), &output[offset]));
+            CHECK(event.time <= songTime && songTime < event.time + STEP);
+            offset += event.bytes.size();
+            next++;
+        }
+    }
+    while (next < events.size() && offset + events[next].bytes.size() <= transport.getOutputLength())
+    {
+        CHECK(std::equal(events[next].bytes.begin(), events[next].bytes.end(), &output[offset]));
+        offset += events[next].bytes.size();
+        next++;
+    }
+    CHECK(next == events.size());
+    CHECK(offset == transport.getOutputLength());
+    CHECK(player.isFinished());
+}
+
+/*A seek sends the last program, chased controllers and pitch bend of each channel
+  it skipped, the parameter number controllers as read, not the notes*/
+static void testChase(void)
+{
+    const uint8_t file[] = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, DIVISION >> 8, DIVISION & 0xff,
+                            'M', 'T', 'r', 'k', 0, 0, 0, 44,
+                            0, 0xc1, 5,                         //Program 5 on channel 2...
+                            0, 0xb1, BankSelect, 1,             //...then the bank
+                            0, 0xb1, ChannelVolume, 90,
+                            0, 101, 0, 0, 100, 0, 0, 6, 12,     //RPN 0(running status):sent as read
+                            0, 74, 64,                          //Not chased
+                            0, 0x91, 60, 100,
+                            0, 0xe1, 0x00, 0x50,
+                            0x83, 0x60, 0xb1, ChannelVolume, 100,//Tick 480
+                            0x83, 0x60, 0xc0, 7,                //Tick 960
+                            0, 0xff, 0x2f, 0};
+    CHECK(player.begin(file, sizeof(file)));
+    transport.clearOutput();
+    CHECK(player.seek(DIVISION + 1));
+    const uint8_t expected[] = {0xb1, 101, 0, 0xb1, 100, 0, 0xb1, 6, 12,
+                                0xb1, BankSelect, 1, 0xc1, 5, 0xb1, ChannelVolume, 100, 0xe1, 0x00, 0x50};
+    CHECK(transport.getOutputLength() == sizeof(expected));
+    CHECK(memcmp(output, expected, sizeof(expected)) == 0);
+}
+
+int main(void)
+{
+    std::vector<ReferenceEvent> events;
+    std::vector<std::pair<uint32_t, uint32_t> > tempos;
+    const std::vector<uint8_t> file = buildFile(events, tempos);
+    decodeTimes(events, tempos);
+
+    midi.begin(MIDI_CHANNEL_OFF);
+    CHECK(player.begin(file.data(), uint32_t(file.size())));
+    CHECK(player.getFormat() == 1 && player.getTrackCount() == TRACKS && player.getDivision() == DIVISION);
+    playAndCheck(events, 0, 1000);
+
+    //Backward and forward seeks, the later ones use the checkpoints recorded on the way
+    const uint32_t lastTick = events.back().tick;
+    const uint32_t targets[] = {lastTick / 2, lastTick / 7, lastTick - DIVISION, 0, lastTick / 3 + 1, lastTick / 2};
+    for (uint32_t target : targets)
+    {
+        player.stop();
+        CHECK(player.seek(target));
+        size_t first = 0;
+        while (first < events.size() && events[first].tick < target)
+        {
+            first++;
+        }
+        playAndCheck(events, first, 5000000);
+    }
+    testChase();
+    return testResult("test_file_player");
+}
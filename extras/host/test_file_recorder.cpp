@@ -0,0 +1,194 @@
+/*************************************************************************
+File:       	  test_file_recorder.cpp
+Author:          BESTMODULES
+Description:    MidiFileRecorder round trip: a stream with SysEx larger than
+                SYS_EX_MAXSIZE(and than the stream buffer) is received and
+                recorded, the file played back by MidiFilePlayer must give the
+                received bytes again
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include "BM_MIDIFilePlayer.h"
+#include "test_util.h"
+#include "host_clock.h"
+
+static std::vector<uint8_t> file;
+
+static size_t writeFile(void *, uint32_t position, const uint8_t *array, size_t length)
+{
+    if (file.size() < position + length)
+    {
+        file.resize(position + length);
+    }
+    std::copy(array, array + length, file.begin() + position);
+    return length;
+}
+
+static void addSysEx(std::vector<uint8_t> &stream, uint16_t size)
+{
+    stream.push_back(SystemExclusiveStart);
+    for (uint16_t i = 0; i + 2 < size; i++)
+    {
+        stream.push_back(uint8_t((i * 7) & 0x7f));
+    }
+    stream.push_back(SystemExclusiveEnd);
+}
+
+/*Note, SysEx of 200 bytes(2 chunks), Control Change, SysEx of 300 bytes(3 chunks), short SysEx, Clock*/
+static std::vector<uint8_t> buildStream(void)
+{
+    std::vector<uint8_t> stream;
+    const uint8_t note[] = {NoteOn, 60, 100};
+    stream.insert(stream.end(), note, note + sizeof(note));
+    addSysEx(stream, 200);
+    const uint8_t control[] = {ControlChange | 2, 7, 90};
+    stream.insert(stream.end(), control, control + sizeof(control));
+    addSysEx(stream, 300);
+    addSysEx(stream, 6);
+    stream.push_back(Clock);
+    return stream;
+}
+
+/*Receive the stream into the recorder(one byte per isMIDIMessageOK(), 320us apart)*/
+static MidiRecorderStats recordStream(const std::vector<uint8_t> &stream, uint8_t *streamBuffer, uint16_t streamSize, bool interruptMode)
+{
+    static MidiMemoryTransport transport;
+    BasicMidiInterface<MidiMemoryTransport> midi(&transport);
+    MidiFileRecorder recorder;
+    hostClockSet(1000);
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.setTimestamp(true);
+    midi.setSysExStream(streamBuffer, streamSize, nullptr);
+    midi.setInterruptMode(interruptMode);
+    midi.setRecorder(&recorder);
+    file.clear();
+    CHECK(recorder.begin(nullptr, writeFile));
+    for (size_t i = 0; i < stream.size(); i++)
+    {
+        transport.setInput(&stream[i], 1);
+        midi.serviceInput();
+        while (midi.isMIDIMessageOK())
+        {
+        }
+        recorder.update();
+        hostClockAdvance(MIDI_BYTE_TIME);
+    }
+    CHECK(recorder.end());
+    return recorder.getStats();
+}
+
+/*Play the recorded file back, return the bytes sent*/
+static std::vector<uint8_t> playFile(void)
+{
+    static uint8_t output[4096];
+    static MidiMemoryTransport transport(output, sizeof(output));
+    BasicMidiInterface<MidiMemoryTransport> midi(&transport);
+    MidiFilePlayer player(&midi);
+    midi.begin(MIDI_CHANNEL_OFF);
+    transport.clearOutput();
+    CHECK(player.begin(file.data(), uint32_t(file.size())));
+    hostClockSet(0);
+    player.play();
+    while (player.update())
+    {
+        hostClockAdvance(1000);
+    }
+    return std::vector<uint8_t>(output, output + transport.getOutputLength());
+}
+
+/*Read the delta time of the first event after the tempo event*/
+static uint32_t firstDelta(void)
+{
+    size_t position = 22 + 7;//Header, tempo event
+    uint32_t value = 0;
+    while (position < file.size())
+    {
+        value = (value << 7) | (file[position] & 0x7f);
+        if (!(file[position++] & 0x80))
+        {
+            break;
+        }
+    }
+    return value;
+}
+
+/*Ticks after 40 minutes(more than 2^31us), and no drift over many short gaps*/
+static void testLongRecording(void)
+{
+    MidiFileRecorder recorder;
+    MidiMessage message = MidiMessage();
+    message.type = NoteOn;
+    message.channel = 1;
+    message.data1 = 60;
+    message.data2 = 100;
+    hostClockSet(5000);
+    file.clear();
+    CHECK(recorder.begin(nullptr, writeFile));
+    recorder.record(message, nullptr, 4000);//Before begin(): tick 0
+    recorder.record(message, nullptr, 5000 + 40UL * 60 * 1000000);
+    hostClockAdvance(40UL * 60 * 1000000);
+    CHECK(recorder.end());
+    CHECK(firstDelta() == 0);
+    CHECK(file.size() > 22 + 7 + 4 && file[22 + 7 + 4] == 0x82);//4,608,000 ticks: 0x82 0x99 0xA0 0x00
+    CHECK(file.size() > 22 + 7 + 7 && file[22 + 7 + 5] == 0x99 && file[22 + 7 + 6] == 0xa0 && file[22 + 7 + 7] == 0x00);
+
+    hostClockSet(0);
+    file.clear();
+    CHECK(recorder.begin(nullptr, writeFile));
+    uint32_t time = 0;
+    for (uint16_t i = 0; i < 1000; i++)
+    {
+        time += 999;//1.918 ticks: the rest is carried
+        recorder.record(message, nullptr, time);
+        recorder.update();
+    }
+    recorder.record(message, nullptr, time + 3125);//6 ticks later
+    CHECK(recorder.getStats().events == 1001);
+    hostClockSet(time + 3125);
+    CHECK(recorder.end());
+    //The ticks of the events add up to 1,002,125us * 960 / 500000 = 1924.08
+    uint32_t total = 0;
+    size_t position = 22 + 7;
+    for (uint16_t i = 0; i < 1001; i++)
+    {
+        uint32_t delta = 0;
+        while (file[position] & 0x80)
+        {
+            delta = (delta << 7) | (file[position++] & 0x7f);
+        }
+        delta = (delta << 7) | file[position++];
+        total += delta;
+        position += (i == 0) ? 3 : 2;//Running status after the first event
+    }
+    CHECK(total == 1924);
+}
+
+int main(void)
+{
+    testLongRecording();
+    const std::vector<uint8_t> stream = buildStream();
+
+    //SYS_EX_MAXSIZE chunks with their 0xF0/0xF7 markers
+    MidiRecorderStats stats = recordStream(stream, nullptr, 0, false);
+    CHECK(stats.dropped == 0);
+    CHECK(playFile() == stream);
+
+    //Streaming mode: every chunk of the stream buffer is recorded
+    uint8_t streamBuffer[48];
+    stats = recordStream(stream, streamBuffer, sizeof(streamBuffer), false);
+    CHECK(stats.dropped == 0);
+    CHECK(playFile() == stream);
+
+    //Streaming in interrupt mode: only the SysEx that fit in one chunk are recorded
+    stats = recordStream(stream, streamBuffer, sizeof(streamBuffer), true);
+    CHECK(stats.dropped == 2);
+    std::vector<uint8_t> expected;
+    const uint8_t messages[] = {NoteOn, 60, 100, ControlChange | 2, 7, 90};
+    expected.insert(expected.end(), messages, messages + sizeof(messages));
+    addSysEx(expected, 6);
+    expected.push_back(Clock);
+    CHECK(playFile() == expected);
+
+    return testResult("test_file_recorder");
+}
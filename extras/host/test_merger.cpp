@@ -0,0 +1,93 @@
+/*************************************************************************
+File:       	  test_merger.cpp
+Author:          BESTMODULES
+Description:    MidiMerger: the output settings are left as they are, a SysEx
+                starting on an input while another SysEx is merged is held
+                and sent whole after it, and the governor does not insert
+                its held values inside a merged SysEx
+History：
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include "test_util.h"
+#include "BM_MIDIMerger.h"
+#include "host_clock.h"
+
+static TestPort output;
+static BasicMidiInterface<MidiMemoryTransport> &midiOut = output.midi;
+static TestPort inputs[2];
+
+//Receive bytes on an input(port 0 or 1)
+static void receive(uint8_t port, const std::vector<uint8_t> &bytes)
+{
+    inputs[port].receive(bytes);
+}
+
+int main(void)
+{
+    hostClockSet(1000000);
+    midiOut.begin(MIDI_CHANNEL_OFF);
+    inputs[0].midi.begin(MIDI_CHANNEL_OMNI);
+    inputs[1].midi.begin(MIDI_CHANNEL_OMNI);
+    MidiMerger merger(&midiOut);
+    CHECK(merger.addInput(&inputs[0].midi) == 0);
+    CHECK(merger.addInput(&inputs[1].midi) == 1);
+
+    //The output running status is not switched on by the merger...
+    receive(0, {0x90, 0x40, 0x64});
+    receive(1, {0x90, 0x41, 0x64});
+    CHECK(output.sent({0x90, 0x40, 0x64, 0x90, 0x41, 0x64}));
+    //...the sketch turns it on for the messages of both inputs
+    midiOut.setRunningStatus(USE_RUNNING_STATUS);
+    receive(0, {0x90, 0x42, 0x64});
+    receive(1, {0x90, 0x43, 0x64});
+    CHECK(output.sent({0x90, 0x42, 0x64, 0x43, 0x64}));
+    midiOut.setRunningStatus(NOT_USE_RUNNING_STATUS);
+
+    //A complete SysEx of input 1 during the SysEx of input 0, then a note
+    receive(0, {0xf0, 0x01, 0x02});
+    receive(1, {0xf0, 0x10, 0x11, 0xf7, 0x90, 0x40, 0x64});
+    CHECK(output.sent({0xf0, 0x01, 0x02}));
+    receive(0, {0x03, 0xf7});
+    CHECK(output.sent({0x03, 0xf7, 0xf0, 0x10, 0x11, 0xf7, 0x90, 0x40, 0x64}));
+    CHECK(merger.getStats(1).messages == 4);//2 notes above
+    CHECK(merger.getStats(1).dropped == 0);
+
+    //The held SysEx is still being received: its input takes the output
+    receive(0, {0xf0, 0x01});
+    receive(1, {0xf0, 0x10});
+    receive(0, {0xf7, 0x80, 0x40, 0x00});
+    CHECK(output.sent({0xf0, 0x01, 0xf7, 0xf0, 0x10}));
+    receive(1, {0x11, 0xf7});
+    CHECK(output.sent({0x11, 0xf7, 0x80, 0x40, 0x00}));
+    CHECK(merger.getStats(1).dropped == 0);
+
+    //A held SysEx larger than MIDI_MERGE_SYSEX_SIZE is dropped whole
+    receive(0, {0xf0});
+    std::vector<uint8_t> large(MIDI_MERGE_SYSEX_SIZE + 8, 0x22);
+    large.front() = 0xf0;
+    large.back() = 0xf7;
+    receive(1, large);
+    receive(0, {0xf7});
+    CHECK(output.sent({0xf0, 0xf7}));
+    CHECK(merger.getStats(1).dropped == 1);
+
+    //The governor holds a controller while the wire is saturated...
+    midiOut.setGovernor(true);
+    const uint8_t saturate[MIDI_GOVERNOR_BACKLOG + 8] = { 0 };
+    midiOut.sendSysEx(sizeof(saturate), saturate);
+    midiOut.sendControlChange(Pan, 5, 1);
+    CHECK(midiOut.getGovernorHeldCount() == 1);
+    output.transport.clearOutput();
+    //...and waits for the end of the merged SysEx to send it
+    receive(0, {0xf0, 0x01});
+    hostClockAdvance(1000000);
+    midiOut.serviceOutput();
+    CHECK(midiOut.getGovernorHeldCount() == 1);
+    receive(0, {0x02, 0xf7});
+    midiOut.serviceOutput();
+    CHECK(midiOut.getGovernorHeldCount() == 0);
+    CHECK(output.sent({0xf0, 0x01, 0x02, 0xf7, 0xb0, Pan, 5}));
+
+    return testResult("test_merger");
+}
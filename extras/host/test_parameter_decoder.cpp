@@ -0,0 +1,96 @@
+/*************************************************************************
+File:       	  test_parameter_decoder.cpp
+Author:          BESTMODULES
+Description:    MidiParameterDecoder on the receive path: an MSB and its LSB
+                give one event, an MSB alone gives its event with the next
+                message or after MIDI_PARAMETER_TIMEOUT
+History：
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include "test_util.h"
+#include "host_clock.h"
+
+static TestPort port;
+static BasicMidiInterface<MidiMemoryTransport> &midi = port.midi;
+static MidiParameterDecoder decoder;
+
+/*Received events: kind(MIDI_PARAMETER_xxx), channel, number, value*/
+struct Event{
+    uint8_t kind;
+    uint8_t channel;
+    uint16_t number;
+    uint16_t value;
+    bool operator==(const Event &other) const
+    {
+        return kind == other.kind && channel == other.channel && number == other.number && value == other.value;
+    }
+};
+static std::vector<Event> events;
+
+static void handleRpn(uint8_t channel, uint16_t number, uint16_t value) { events.push_back({MIDI_PARAMETER_RPN, channel, number, value}); }
+static void handleNrpn(uint8_t channel, uint16_t number, uint16_t value) { events.push_back({MIDI_PARAMETER_NRPN, channel, number, value}); }
+static void handleControlChange14(uint8_t channel, uint8_t number, uint16_t value) { events.push_back({MIDI_PARAMETER_CC14, channel, number, value}); }
+
+static bool launched(const std::vector<Event> &expected)
+{
+    const bool equal = events == expected;
+    events.clear();
+    return equal;
+}
+
+int main(void)
+{
+    hostClockSet(0);
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.setParameterDecoder(&decoder);
+    midi.setHandleRpn(handleRpn);
+    midi.setHandleNrpn(handleNrpn);
+    midi.setHandleControlChange14(handleControlChange14);
+
+    //14-bit controller: MSB then LSB is one event
+    port.receive({0xb0, ModulationWheel, 0x10, ModulationWheel + 32, 0x05});
+    CHECK(launched({{MIDI_PARAMETER_CC14, 1, ModulationWheel, (0x10 << 7) | 0x05}}));
+    //LSB alone: event with the last MSB
+    port.receive({0xb0, ModulationWheel + 32, 0x06});
+    CHECK(launched({{MIDI_PARAMETER_CC14, 1, ModulationWheel, (0x10 << 7) | 0x06}}));
+
+    //MSB alone: the event waits for the next message(LSB cleared)
+    port.receive({0xb1, ChannelVolume, 0x20});
+    CHECK(launched({}));
+    port.receive({0xfe});
+    CHECK(launched({{MIDI_PARAMETER_CC14, 2, ChannelVolume, 0x20 << 7}}));
+    //The next MSB(another channel) releases it too
+    port.receive({0xb1, ChannelVolume, 0x21, 0xb2, ChannelVolume, 0x22, 0x92, 0x40, 0x64});
+    CHECK(launched({{MIDI_PARAMETER_CC14, 2, ChannelVolume, 0x21 << 7}, {MIDI_PARAMETER_CC14, 3, ChannelVolume, 0x22 << 7}}));
+    //An LSB of another channel is not its LSB
+    port.receive({0xb0, Pan, 0x01, 0xb3, Pan + 32, 0x02});
+    CHECK(launched({{MIDI_PARAMETER_CC14, 1, Pan, 0x01 << 7}, {MIDI_PARAMETER_CC14, 4, Pan, 0x02}}));
+
+    //RPN: Data Entry MSB then LSB is one event
+    port.receive({0xb0, 101, 0x00, 100, 0x00, 6, 0x02, 38, 0x40});
+    CHECK(launched({{MIDI_PARAMETER_RPN, 1, 0x0000, (0x02 << 7) | 0x40}}));
+    //Data Entry MSB alone, then an increment
+    port.receive({0xb0, 6, 0x03, 96, 0x00});
+    CHECK(launched({{MIDI_PARAMETER_RPN, 1, 0x0000, 0x03 << 7}, {MIDI_PARAMETER_RPN, 1, 0x0000, (0x03 << 7) + 1}}));
+    //Increment and decrement by their value byte
+    port.receive({0xb0, 96, 0x05, 97, 0x02});
+    CHECK(launched({{MIDI_PARAMETER_RPN, 1, 0x0000, (0x03 << 7) + 6}, {MIDI_PARAMETER_RPN, 1, 0x0000, (0x03 << 7) + 4}}));
+
+    //MSB alone and nothing received: the event is given after MIDI_PARAMETER_TIMEOUT
+    port.receive({0xb0, ChannelVolume, 0x30});
+    hostClockAdvance(MIDI_PARAMETER_TIMEOUT - 1);
+    CHECK(!midi.isMIDIMessageOK());
+    CHECK(launched({}));
+    hostClockAdvance(1);
+    CHECK(!midi.isMIDIMessageOK());
+    CHECK(launched({{MIDI_PARAMETER_CC14, 1, ChannelVolume, 0x30 << 7}}));
+    port.receive({0xb0, ChannelVolume + 32, 0x01});//A late LSB is an event of its own
+    CHECK(launched({{MIDI_PARAMETER_CC14, 1, ChannelVolume, (0x30 << 7) | 0x01}}));
+
+    //NRPN
+    port.receive({0xb5, 99, 0x01, 98, 0x02, 6, 0x7f, 38, 0x7f, 101, 0x7f, 100, 0x7f});
+    CHECK(launched({{MIDI_PARAMETER_NRPN, 6, (0x01 << 7) | 0x02, 0x3fff}}));
+
+    return testResult("test_parameter_decoder");
+}
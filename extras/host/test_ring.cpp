@@ -0,0 +1,204 @@
+/*************************************************************************
+File:       	  test_ring.cpp
+Author:          BESTMODULES
+Description:    MidiRing and the interrupt receive mode with the producer on
+                another thread: no message is torn, duplicated or reordered,
+                and every message is either popped or counted as an overflow
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include <atomic>
+#include <thread>
+#include "test_util.h"
+
+#define MESSAGES    200000
+
+/*Each message carries its sequence number, the other fields are derived from it*/
+static MidiPacket makePacket(uint32_t sequence)
+{
+    MidiPacket packet;
+    packet.type = ControlChange;
+    packet.channel = uint8_t(sequence % 16 + 1);
+    packet.data1 = uint8_t(sequence & 0x7f);
+    packet.data2 = uint8_t((sequence >> 7) & 0x7f);
+    return packet;
+}
+
+static bool isWhole(const MidiPacket &packet)
+{
+    return packet.type == ControlChange && packet.channel == (((packet.data2 << 7) | packet.data1) % 16 + 1);
+}
+
+/*The producer spins while the ring is full: every item arrives, in order*/
+static void testRing(void)
+{
+    static MidiRing<MidiPacket, MIDI_RX_QUEUE_SIZE> ring;
+    std::thread producer([]()
+    {
+        for (uint32_t i = 0; i < MESSAGES; i++)
+        {
+            while (!ring.push(makePacket(i)))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint32_t expected = 0;
+    while (expected < MESSAGES)
+    {
+        MidiPacket packet;
+        if (ring.pop(packet))
+        {
+            CHECK(isWhole(packet));
+            CHECK(((packet.data2 << 7 | packet.data1) & 0x3fff) == (expected & 0x3fff));
+            expected++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    MidiPacket packet;
+    CHECK(!ring.pop(packet));
+}
+
+/*serviceInput() parses on the producer thread, pop() reads on this one:
+  the messages popped keep their order, the others are counted as overflows*/
+static void testInterruptMode(void)
+{
+    static uint8_t stream[MESSAGES * 3];
+    for (uint32_t i = 0; i < MESSAGES; i++)
+    {
+        const MidiPacket packet = makePacket(i);
+        stream[i * 3] = uint8_t(ControlChange | (packet.channel - 1));
+        stream[i * 3 + 1] = packet.data1;
+        stream[i * 3 + 2] = packet.data2;
+    }
+    static MidiMemoryTransport transport;
+    static BasicMidiInterface<MidiMemoryTransport> midi(&transport);
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.setInterruptMode(true);
+
+    std::atomic<bool> done(false);
+    std::thread producer([&done]()
+    {
+        for (uint32_t i = 0; i < MESSAGES; i += 64)
+        {
+            const uint32_t count = (MESSAGES - i < 64) ? MESSAGES - i : 64;
+            transport.setInput(&stream[i * 3], count * 3);
+            midi.serviceInput();
+            std::this_thread::yield();
+        }
+        done.store(true, std::memory_order_release);
+    });
+    uint32_t popped = 0;
+    int32_t last = -1;
+    for (;;)
+    {
+        const bool finished = done.load(std::memory_order_acquire);
+        MidiPacket packet;
+        while (midi.pop(packet))
+        {
+            CHECK(isWhole(packet));
+            const int32_t sequence = packet.data2 << 7 | packet.data1;
+            CHECK(sequence != (last & 0x3fff));
+            last = sequence;
+            popped++;
+        }
+        if (finished)
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    producer.join();
+    CHECK(popped > 0);
+    CHECK(uint16_t(popped + midi.getQueueOverflowCount()) == uint16_t(MESSAGES));//The overflow count wraps
+}
+/*A message queued in interrupt mode keeps the time its bytes were parsed,
+  not the time it is dispatched*/
+static uint32_t clockValue = 0;
+static unsigned long testClock(void) { return clockValue; }
+static void testArrivalTime()
+{
+    static MidiMemoryTransport transport;
+    static BasicMidiInterface<MidiMemoryTransport> midi(&transport);
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.setTimestamp(true, testClock);
+    midi.setInterruptMode(true);
+    const uint8_t first[] = {0x90, 0x40, 0x64};
+    const uint8_t second[] = {0x80, 0x40, 0x00};
+    clockValue = 1000;
+    transport.setInput(first, sizeof(first));
+    midi.serviceInput();
+    clockValue = 2000;
+    transport.setInput(second, sizeof(second));
+    midi.serviceInput();
+    clockValue = 5000;
+    CHECK(midi.isMIDIMessageOK() && midi.getMessageTimestamp() == 1000);
+    CHECK(midi.isMIDIMessageOK() && midi.getMessageTimestamp() == 2000);
+    CHECK(midi.getDispatchDelay().maximum == 4000);
+}
+/*A SysEx queued in interrupt mode keeps its payload until it is read:
+  a SysEx received meanwhile is dropped, not written over it*/
+static void testSysExBusy()
+{
+    static MidiMemoryTransport transport;
+    static BasicMidiInterface<MidiMemoryTransport> midi(&transport);
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.setInterruptMode(true);
+    const uint8_t input[] = {0xf0, 0x01, 0x02, 0xf7, 0xf0, 0x11, 0x12, 0xf7, 0x90, 0x40, 0x64};
+    transport.setInput(input, sizeof(input));
+    midi.serviceInput();
+    uint8_t payload[SYS_EX_MAXSIZE];
+    CHECK(midi.isMIDIMessageOK() && midi.getMessageType() == SystemExclusive);
+    CHECK(midi.getSysExArray(payload) == 4 && payload[1] == 0x01 && payload[2] == 0x02);
+    CHECK(midi.isMIDIMessageOK() && midi.getMessageType() == NoteOn);
+    CHECK(midi.getQueueOverflowCount() == 1);
+    //Released once read: the next SysEx is received
+    const uint8_t next[] = {0xf0, 0x21, 0xf7};
+    transport.setInput(next, sizeof(next));
+    midi.serviceInput();
+    CHECK(midi.isMIDIMessageOK() && midi.getSysExArray(payload) == 3 && payload[1] == 0x21);
+}
+/*The drain mode stops when the queue is full or a SysEx is queued: the
+  bytes wait in the transport, every message and payload is delivered*/
+static void testDrainBackpressure()
+{
+    static MidiMemoryTransport transport;
+    static BasicMidiInterface<MidiMemoryTransport> midi(&transport);
+    midi.begin(MIDI_CHANNEL_OMNI);
+    midi.setDrainMode(true);
+    std::vector<uint8_t> input;
+    for (uint8_t note = 0; note < 2 * MIDI_RX_QUEUE_SIZE; note++)
+    {
+        input.insert(input.end(), {0x90, note, 0x64});
+    }
+    input.insert(input.end(), {0xf0, 0x01, 0xf7, 0xf0, 0x02, 0xf7});
+    transport.setInput(input.data(), input.size());
+    uint8_t note = 0;
+    while (midi.isMIDIMessageOK() && midi.getMessageType() == NoteOn)
+    {
+        CHECK(midi.getMessageData1() == note);
+        note++;
+    }
+    CHECK(note == 2 * MIDI_RX_QUEUE_SIZE);
+    uint8_t payload[SYS_EX_MAXSIZE];
+    CHECK(midi.getMessageType() == SystemExclusive && midi.getSysExArray(payload) == 3 && payload[1] == 0x01);
+    CHECK(midi.isMIDIMessageOK() && midi.getSysExArray(payload) == 3 && payload[1] == 0x02);
+    CHECK(midi.getQueueOverflowCount() == 0);
+}
+
+int main(void)
+{
+    //The arrival time is kept beside the ring slot, not in it
+    CHECK(sizeof(MidiPacket) == 4);
+    testRing();
+    testInterruptMode();
+    testArrivalTime();
+    testSysExBusy();
+    testDrainBackpressure();
+    return testResult("test_ring");
+}
@@ -0,0 +1,54 @@
+/*************************************************************************
+File:       	  test_thru.cpp
+Author:          BESTMODULES
+Description:    Soft thru: the received bytes are forwarded as received(running
+                status, interleaved real time), the channel and type masks
+                filter whole messages, and the status byte is sent again after
+                a message of the output itself
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include "test_util.h"
+
+static TestPort input;
+static TestPort output;
+
+int main(void)
+{
+    input.midi.begin(MIDI_CHANNEL_OMNI);
+    output.midi.begin(MIDI_CHANNEL_OFF);
+    input.midi.setThru(&output.midi);
+
+    //Byte-identical: running status, real time inside messages and inside a SysEx
+    const std::vector<uint8_t> stream = {0x90, 60, 100, 62, 0xf8, 100, 0xb0, 7, 0xf8, 90, 10, 80,
+                                         0xf0, 0x01, 0xf8, 0x02, 0xf7, 0xf2, 0x10, 0x20, 0xfe};
+    input.receive(stream);
+    CHECK(output.sent(stream));
+    CHECK(input.midi.getThruByteCount() == stream.size());
+
+    //Channel mask: the messages of the other channels are dropped with their running status
+    input.midi.setThruChannelMask(0x0001);
+    input.receive({0x90, 60, 100, 0x91, 60, 100, 62, 100, 0x80, 60, 0});
+    CHECK(output.sent({0x90, 60, 100, 0x80, 60, 0}));
+    input.midi.setThruChannelMask(MIDI_CHANNEL_MASK_ALL);
+
+    //Type mask: Control Change and Clock are not forwarded
+    input.midi.setThruTypeMask(MIDI_TYPE_MASK_ALL & ~MIDI_TYPE_BIT(ControlChange) & ~MIDI_TYPE_BIT(Clock));
+    input.receive({0xb0, 7, 100, 0xf8, 0x90, 60, 100, 0xf8, 61, 100});
+    CHECK(output.sent({0x90, 60, 100, 61, 100}));
+    input.midi.setThruTypeMask(MIDI_TYPE_MASK_ALL);
+
+    //A message of the output between two forwarded ones: the status is sent again
+    input.receive({0x90, 60, 100});
+    output.midi.sendControlChange(7, 101, 1);
+    input.receive({62, 100});
+    CHECK(output.sent({0x90, 60, 100, 0xb0, 7, 101, 0x90, 62, 100}));
+    //Inside a forwarded message: its rest is dropped, the next one gets its status
+    input.receive({0x90, 64});
+    output.midi.sendControlChange(7, 102, 1);
+    input.receive({100, 65, 100});
+    CHECK(output.sent({0x90, 64, 0xb0, 7, 102, 0x90, 65, 100}));
+
+    return testResult("test_thru");
+}
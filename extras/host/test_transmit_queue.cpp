@@ -0,0 +1,140 @@
+/*************************************************************************
+File:       	  test_transmit_queue.cpp
+Author:          BESTMODULES
+Description:    Clock latency on a saturated link: notes are sent faster than
+                31250 baud carries them, the Clock bytes must leave within
+                (MIDI_TX_UART_DEPTH + 1) byte times in queued mode
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； g++ -std=c++11
+
+**************************************************************************/
+#include <deque>
+#include "test_util.h"
+#include "host_clock.h"
+
+#define UART_SIZE       64      //Transmit buffer of the serial port
+#define POLL_TIME       4       //us spent by each availableForWrite() call
+#define LOOP_TIME       100     //us between two passes of the test loop
+#define CLOCK_PERIOD    20833   //us, 24 Clock per quarter note at 120 bpm
+#define TEST_TIME       2000000 //us
+
+/*Serial port model: UART_SIZE bytes buffer, one byte leaves every MIDI_BYTE_TIME,
+  write() waits(moves the host clock) when the buffer is full*/
+class UartTransport
+{
+public:
+    UartTransport() : _shiftStart(0) {}
+
+    void begin(unsigned long) {}
+    int available(void) { return 0; }
+    int read(void) { return -1; }
+    int availableForWrite(void)
+    {
+        hostClockAdvance(POLL_TIME);
+        update();
+        return int(UART_SIZE - _buffer.size());
+    }
+    size_t write(const uint8_t *array, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            update();
+            while (_buffer.size() >= UART_SIZE)
+            {
+                hostClockAdvance(MIDI_BYTE_TIME - (micros() - _shiftStart));
+                update();
+            }
+            if (_buffer.empty())
+            {
+                _shiftStart = micros();
+            }
+            _buffer.push_back(array[i]);
+        }
+        return length;
+    }
+    //Departure time of the Clock bytes sent since the last call
+    std::vector<uint32_t> takeClocks(void)
+    {
+        update();
+        std::vector<uint32_t> clocks;
+        clocks.swap(_clocks);
+        return clocks;
+    }
+
+private:
+    void update(void)
+    {
+        while (!_buffer.empty() && micros() - _shiftStart >= MIDI_BYTE_TIME)
+        {
+            _shiftStart += MIDI_BYTE_TIME;//The byte has left, the next one starts
+            if (_buffer.front() == Clock)
+            {
+                _clocks.push_back(_shiftStart);
+            }
+            _buffer.pop_front();
+        }
+    }
+    std::deque<uint8_t> _buffer;
+    uint32_t            _shiftStart;//us, start of the byte being shifted out
+    std::vector<uint32_t> _clocks;
+};
+
+/*Send 6-note chords every millisecond and a Clock every CLOCK_PERIOD,
+  return the largest delay between sendClock() and the Clock leaving*/
+static uint32_t maxClockLatency(bool queued)
+{
+    UartTransport uart;
+    BasicMidiInterface<UartTransport> midi(&uart);
+    hostClockSet(0);
+    midi.begin(MIDI_CHANNEL_OFF);
+    midi.setTransmitQueue(queued);
+    std::deque<uint32_t> sent;//sendClock() times of the Clocks not gone yet
+    uint32_t nextChord = 0;
+    uint32_t nextClock = 0;
+    uint32_t maximum = 0;
+    uint8_t note = 0;
+    while (micros() < TEST_TIME)
+    {
+        if (micros() >= nextChord)
+        {
+            for (uint8_t i = 0; i < 6; i++)
+            {
+                midi.sendNoteOn(48 + (note++ & 31), 100, 1);
+            }
+            nextChord += 1000;
+        }
+        if (micros() >= nextClock)
+        {
+            sent.push_back(micros());
+            midi.sendClock();
+            nextClock += CLOCK_PERIOD;
+        }
+        midi.serviceOutput();
+        hostClockAdvance(LOOP_TIME);
+        for (uint32_t departure : uart.takeClocks())
+        {
+            const uint32_t latency = departure - sent.front();
+            maximum = (latency > maximum) ? latency : maximum;
+            sent.pop_front();
+        }
+    }
+    while (midi.getTransmitQueueCount() != 0)
+    {
+        midi.serviceOutput();
+    }
+    hostClockAdvance(UART_SIZE * MIDI_BYTE_TIME);
+    CHECK(uart.takeClocks().size() == sent.size());//Every Clock has left
+    return maximum;
+}
+
+int main(void)
+{
+    const uint32_t bound = (MIDI_TX_UART_DEPTH + 1) * MIDI_BYTE_TIME + LOOP_TIME;
+    const uint32_t direct = maxClockLatency(false);
+    const uint32_t queued = maxClockLatency(true);
+    printf("clock latency: direct %luus, queued %luus(bound %luus)\n",
+           (unsigned long)direct, (unsigned long)queued, (unsigned long)bound);
+    CHECK(queued <= bound);
+    CHECK(direct > bound);//The link is saturated: the bytes of the serial port buffer go first
+    return testResult("test_transmit_queue");
+}
@@ -0,0 +1,56 @@
+/***************************************************************************
+File:       		test_util.h
+Author:           BESTMODULE
+Description:      Helpers shared by the host tests: CHECK(), the test result
+                  and a MIDI port on memory(input bytes in, output bytes out)
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；g++ -std=c++11
+
+****************************************************************************/
+#ifndef _TEST_UTIL_H
+#define _TEST_UTIL_H
+
+#include <vector>
+#include <stdio.h>
+#include "BMV51M001.h"
+#include "BM_MIDITransport.h"
+
+static int failures = 0;
+#define CHECK(condition) do { if (!(condition)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+//Print the result of the test, return the exit code of main()
+inline int testResult(const char *name)
+{
+    printf("%s: %s\n", name, failures == 0 ? "OK" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
+
+/*An interface on a memory transport: receive() feeds it, sent() checks what it wrote*/
+struct TestPort{
+    TestPort() : transport(output, sizeof(output)), midi(&transport) {}
+
+    //Read the bytes through isMIDIMessageOK() until they are all parsed
+    void receive(const std::vector<uint8_t> &bytes)
+    {
+        transport.setInput(bytes.data(), bytes.size());
+        while (transport.available() > 0)
+        {
+            midi.isMIDIMessageOK();
+        }
+    }
+    //Bytes written since the last call
+    std::vector<uint8_t> written(void)
+    {
+        const std::vector<uint8_t> bytes(output, output + transport.getOutputLength());
+        transport.clearOutput();
+        return bytes;
+    }
+    //true if the bytes written since the last call are the expected ones
+    bool sent(const std::vector<uint8_t> &expected) { return written() == expected; }
+
+    uint8_t output[1024];
+    MidiMemoryTransport transport;
+    BasicMidiInterface<MidiMemoryTransport> midi;
+};
+
+#endif
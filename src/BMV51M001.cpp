@@ -7,54 +7,127 @@ History：
 
 **************************************************************************/
 #include "BMV51M001.h"
+
+/*Status byte decoding table: type in the low byte, MIDI_STATUS_xxx flags in the high byte*/
+#define MIDI_STATUS_ROW(h) \
+    midiStatusEntry(h|0x0), midiStatusEntry(h|0x1), midiStatusEntry(h|0x2), midiStatusEntry(h|0x3), \
+    midiStatusEntry(h|0x4), midiStatusEntry(h|0x5), midiStatusEntry(h|0x6), midiStatusEntry(h|0x7), \
+    midiStatusEntry(h|0x8), midiStatusEntry(h|0x9), midiStatusEntry(h|0xa), midiStatusEntry(h|0xb), \
+    midiStatusEntry(h|0xc), midiStatusEntry(h|0xd), midiStatusEntry(h|0xe), midiStatusEntry(h|0xf)
+
+const uint16_t sMidiStatusTable[256] PROGMEM =
+{
+    MIDI_STATUS_ROW(0x00), MIDI_STATUS_ROW(0x10), MIDI_STATUS_ROW(0x20), MIDI_STATUS_ROW(0x30),
+    MIDI_STATUS_ROW(0x40), MIDI_STATUS_ROW(0x50), MIDI_STATUS_ROW(0x60), MIDI_STATUS_ROW(0x70),
+    MIDI_STATUS_ROW(0x80), MIDI_STATUS_ROW(0x90), MIDI_STATUS_ROW(0xa0), MIDI_STATUS_ROW(0xb0),
+    MIDI_STATUS_ROW(0xc0), MIDI_STATUS_ROW(0xd0), MIDI_STATUS_ROW(0xe0), MIDI_STATUS_ROW(0xf0),
+};
 /************************************************************************* 
 Description:    Constructor
 parameter:
-    Input:          *theSerial : Wire object if your board has more than one UART interface
+    Input:          *transport : the transport object(HardwareSerial, SoftwareSerial...)
+                    writeFunction : writes a block of bytes to the transport
+                    writeSpaceFunction : returns the free space of the transport transmit buffer
     Output:         
 Return:         
-Others:         
+Others:         Built by BasicMidiInterface<Transport>
 *************************************************************************/
-BMV51M001::BMV51M001(HardwareSerial *theSerial)
+MidiInterfaceCore::MidiInterfaceCore(void *transport, MidiWriteFunction writeFunction, MidiWriteSpaceFunction writeSpaceFunction)
 {
-    _serial = theSerial; 
+    _mTransport = transport;
+    _mWrite = writeFunction;
+    _mWriteSpace = writeSpaceFunction;
     _mInputChannel = 0;
+    _mChannelMask = MIDI_CHANNEL_MASK_ALL;
+    _mTypeMask = MIDI_TYPE_MASK_ALL;
     _mPendingMessageIndex = 0;
     _mMidiDatabytes = 0;
-    _mRunningStatus = false;
     _mRunningStatus_TX = InvalidType;
     _mRunningStatus_RX = InvalidType;
-    _mCurrentRpnNumber = 0xffff;
-    _mCurrentNrpnNumber = 0xffff;
+    resetParameterSelect();
     _useRunningStatus = false;
+    _mFoldNoteOff = false;
+    _mRunningStatusRefresh = 0;
+    _mRunningStatusTime = 0;
+    _mRunningStatusSaved = 0;
+    _mDrainMode = false;
+    _mDrainByteBudget = 0;
+    _mDrainTimeBudget = 0;
+    _mInterruptMode = false;
+    _mCoalesce = false;
+    _mCoalesced = 0;
+    _mSysExSplit = false;
+    _mSysExBusy = false;
+    _mSysExPopped = false;
+    _mSysExDropped = 0;
+    _mSysExBuffer = _mSysExArray;
+    _mSysExStream = nullptr;
+    _mSysExCapacity = 0;
+    _mSysExLength = 0;
+    _mSysExFirst = false;
+    memset(&_mMessageEntry, 0, sizeof(_mMessageEntry));
+    _mThruOutput = nullptr;
+    _mThruChannelMask = MIDI_CHANNEL_MASK_ALL;
+    _mThruTypeMask = MIDI_TYPE_MASK_ALL;
+    _mThruStatus = 0;
+    _mThruLength = 0;
+    _mThruIndex = 0;
+    _mThruPass = false;
+    _mThruWire = 0;
+    _mThruBytes = 0;
+    _mNoteTracker = nullptr;
+    _mNoteSources = 0;
+    _mControllerCache = nullptr;
+    _mParameterDecoder = nullptr;
+    _mParameterTime = 0;
+    _mRecorder = nullptr;
+    _mCacheSaved = 0;
+    memset(_mDispatch, 0, sizeof(_mDispatch));
+    _mHandlerContext = nullptr;
+    _mHooks = 0;
+    _mPendingType = InvalidType;
+    _mPendingFlags = 0;
+    _mTxLength = 0;
+    _mTxBatch = false;
+    _mTxQueued = false;
+    _mGovernor = false;
+    _mGovernorRelease = false;
+    _mRawSysEx = false;
+    _mWireFree = 0;
+    _mGovernorCount = 0;
+    _mGovernorDropped = 0;
+    _mTxUartSize = 0;
+    _mClock = nullptr;
+    _mPendingTime = 0;
+    _mParsedTime = 0;
+    resetDispatchDelay();
 }
 /************************************************************************* 
-Description:    MIDI communication initialization
+Description:    MIDI state initialization
 parameter:
     Input:          inputChannel：Set the MIDI input channel(Unique Value 1)
     Output:         
 Return:         
-Others:         
+Others:         Called by begin() once the transport is started
 *************************************************************************/
-void BMV51M001::begin(uint8_t inputChannel)
+void MidiInterfaceCore::initialize(uint8_t inputChannel)
 {
-    _serial->begin(31250);  
-    
-    _mInputChannel = inputChannel;
+    setInputChannel(inputChannel);
     _mRunningStatus_TX = InvalidType;
     _mRunningStatus_RX = InvalidType;
 
     _mPendingMessageIndex = 0;
     _mMidiDatabytes = 0;
 
-    _mCurrentRpnNumber  = 0xffff;
-    _mCurrentNrpnNumber = 0xffff;
+    resetParameterSelect();
 
     _midiMessage.valid   = false;
     _midiMessage.type    = InvalidType;
     _midiMessage.channel = 0;
     _midiMessage.data1   = 0;
     _midiMessage.data2   = 0;
+    setSysExArray();
+    _mMessageTime = 0;
 }
 
 
@@ -71,7 +144,7 @@ parameter:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::send(MidiType type, uint8_t data1, uint8_t data2, uint8_t channel)
+void MidiInterfaceCore::send(MidiType type, uint8_t data1, uint8_t data2, uint8_t channel)
 {
     if (type <= PitchBend)// Channel messages
     {
@@ -81,29 +154,89 @@ void BMV51M001::send(MidiType type, uint8_t data1, uint8_t data2, uint8_t channe
         }
         data1 &= 0x7f;//The value ranges from 0x00 to 0x7f to prevent users from sending incorrect data
         data2 &= 0x7f;
+
+        if (_useRunningStatus && _mFoldNoteOff && type == NoteOff)
+        {
+            type = NoteOn;//A NoteOn with 0 velocity is a NoteOff and keeps the running status
+            data2 = 0;
+        }
         
+        if (_mNoteTracker != nullptr && (_mNoteSources & MIDI_TRACK_SENT) && type <= NoteOn)
+        {
+            if (type == NoteOn && data2 != 0)
+            {
+                _mNoteTracker->noteOn(channel, data1);
+            }
+            else
+            {
+                _mNoteTracker->noteOff(channel, data1);
+            }
+        }
+
+        if (type == ControlChange && data1 >= NRPNLSB && data1 <= RPNMSB)
+        {
+            //Parameter number byte: remember it for the channel(beginRpn(), beginNrpn())
+            const uint8_t index = (channel - 1) & 0x0f;
+            const uint8_t select = (data1 >= RPNLSB) ? MIDI_PARAMETER_RPN : MIDI_PARAMETER_NRPN;
+            if (_mParameterSelect[index] != select)
+            {
+                _mParameterMsb[index] = 0xff;//The other byte of the new kind is not known
+                _mParameterLsb[index] = 0xff;
+                _mParameterSelect[index] = select;
+            }
+            if (data1 & 0x01)
+            {
+                _mParameterMsb[index] = data2;
+            }
+            else
+            {
+                _mParameterLsb[index] = data2;
+            }
+        }
+
         uint8_t status = (type|((channel-1)&0x0f));//aaaannnn,aaaa is instruction,nnnn is channel
 
+        if (_mControllerCache != nullptr && !_mControllerCache->update(type, channel, data1, data2))
+        {
+            //Same value as the last one sent: count the bytes the message would have taken
+            _mCacheSaved += (type == ProgramChange || type == AfterTouchChannel) ? 1 : 2;
+            if (!_useRunningStatus || _mRunningStatus_TX != status)
+            {
+                _mCacheSaved++;
+            }
+            return;
+        }
+        if (_mGovernor && !_mGovernorRelease && holdValue(type, data1, data2, channel))
+        {
+            return;//Sent when the wire has room, or replaced by a newer value
+        }
+
         if(beginTransmission(type))
         {
-            if (_mRunningStatus)
+            if (_useRunningStatus)
             {
-                if (_mRunningStatus_TX != status)//Note The status bytes have changed
+                if ((_mRunningStatus_TX != status)//Note The status bytes have changed
+                ||  (_mRunningStatusRefresh != 0 && (millis() - _mRunningStatusTime) >= _mRunningStatusRefresh))
                 {
                     _mRunningStatus_TX = status;//Store the new status bytes for the next comparison
-                    _serial->write(_mRunningStatus_TX);
-                }		
+                    txByte(_mRunningStatus_TX);
+                    _mRunningStatusTime = millis();
+                }
+                else
+                {
+                    _mRunningStatusSaved++;
+                }
             }
             else//Do not use the run state
             {
-                _serial->write(status);//No running state is used, so the status bytes are sent regardless of whether they change
+                txByte(status);//No running state is used, so the status bytes are sent regardless of whether they change
             }
             
             /*Sending data part*/
-            _serial->write(data1);
+            txByte(data1);
             if (type != ProgramChange && type != AfterTouchChannel)//Except for these two state bytes,  all other channel messages contain two data bytes
             {
-                _serial->write(data2);
+                txByte(data2);
             }
             endTransmission();
         }
@@ -114,6 +247,69 @@ void BMV51M001::send(MidiType type, uint8_t data1, uint8_t data2, uint8_t channe
     }
 }
 /************************************************************************* 
+Description:    Send a batch of channel messages(a chord...) with one write:
+                the messages are grouped by status byte, so each group needs
+                one status byte(running status), then written together
+parameter:
+    Input:      events：the messages
+                count：the number of messages
+    Output:         
+Return:         
+Others:         The groups follow the first message of each status, the messages
+                of a group keep their order: the batch is taken as simultaneous
+                events. With foldNoteOff(setRunningStatus()) the NoteOff and NoteOn
+                of a channel are one group. Grouping costs count x count status
+                comparisons, batches are meant to be small. A batch larger than
+                MIDI_TX_BUFFER_SIZE bytes takes several writes.
+**************************************************************************/
+void MidiInterfaceCore::sendEvents(const MidiEvent *events, size_t count)
+{
+    const bool batch = _mTxBatch;
+    const bool runningStatus = _useRunningStatus;
+    if (!runningStatus)
+    {
+        _mRunningStatus_TX = InvalidType;//Not kept up to date while running status is off
+    }
+    _useRunningStatus = true;
+    _mTxBatch = true;
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t status = eventStatus(events[i]);
+        size_t first = 0;
+        while (first < i && eventStatus(events[first]) != status)
+        {
+            first++;
+        }
+        if (first < i)
+        {
+            continue;//The group of this status has been sent
+        }
+        for (size_t j = i; j < count; j++)
+        {
+            if (eventStatus(events[j]) == status)
+            {
+                send(events[j].type, events[j].data1, events[j].data2, events[j].channel);
+            }
+        }
+    }
+    _useRunningStatus = runningStatus;
+    _mTxBatch = batch;
+    endTransmission();
+}
+/************************************************************************* 
+Description:    Get the status byte sendEvents() groups a message by
+parameter:
+    Input:      event：the message
+    Output:         
+Return:         the status byte(NoteOff folded into NoteOn if foldNoteOff is set)
+Others:         
+**************************************************************************/
+uint8_t MidiInterfaceCore::eventStatus(const MidiEvent &event)
+{
+    const uint8_t type = (_mFoldNoteOff && event.type == NoteOff) ? uint8_t(NoteOn) : uint8_t(event.type);
+    return uint8_t(type | ((event.channel - 1) & 0x0f));
+}
+/************************************************************************* 
 Description:    Send a Note Off message
 parameter:
     Input:      noteNumber：Pitch value in the MIDI format (0 to 127).
@@ -123,7 +319,7 @@ Output:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendNoteOff(uint8_t noteNumber, uint8_t velocity, uint8_t channel)
+void MidiInterfaceCore::sendNoteOff(uint8_t noteNumber, uint8_t velocity, uint8_t channel)
 {
     send(NoteOff, noteNumber, velocity, channel);
 }
@@ -138,7 +334,7 @@ Output:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendNoteOn(uint8_t noteNumber, uint8_t velocity, uint8_t channel)
+void MidiInterfaceCore::sendNoteOn(uint8_t noteNumber, uint8_t velocity, uint8_t channel)
 {
     send(NoteOn, noteNumber, velocity, channel);
 }
@@ -152,7 +348,7 @@ Output:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendPolyPressure(uint8_t noteNumber, uint8_t pressure, uint8_t channel)
+void MidiInterfaceCore::sendPolyPressure(uint8_t noteNumber, uint8_t pressure, uint8_t channel)
 {
   send(AfterTouchPoly, noteNumber, pressure, channel);
 }
@@ -166,7 +362,7 @@ Output:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendControlChange(uint8_t controlNumber, uint8_t controlValue, uint8_t channel)
+void MidiInterfaceCore::sendControlChange(uint8_t controlNumber, uint8_t controlValue, uint8_t channel)
 {
     send(ControlChange, controlNumber, controlValue, channel);
 }
@@ -179,7 +375,7 @@ Output:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendProgramChange(uint8_t programNumber, uint8_t channel)
+void MidiInterfaceCore::sendProgramChange(uint8_t programNumber, uint8_t channel)
 {
     send(ProgramChange, programNumber, 0, channel);
 }
@@ -192,7 +388,7 @@ Output:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendAfterTouch(uint8_t pressure, uint8_t channel)
+void MidiInterfaceCore::sendAfterTouch(uint8_t pressure, uint8_t channel)
 {
   send(AfterTouchChannel, pressure, 0, channel);
 }
@@ -209,7 +405,7 @@ Output:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendPitchBend(int16_t pitchValue, uint8_t channel)
+void MidiInterfaceCore::sendPitchBend(int16_t pitchValue, uint8_t channel)
 {
   const unsigned bend = unsigned(pitchValue - int(MIDI_PITCHBEND_MIN));
   send(PitchBend, (bend & 0x7f), (bend >> 7) & 0x7f, channel);	
@@ -227,7 +423,7 @@ Output:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendSysEx(uint16_t length, const uint8_t* array, bool arrayContainsBoundaries)
+void MidiInterfaceCore::sendSysEx(uint16_t length, const uint8_t* array, bool arrayContainsBoundaries)
 {
     const bool writeBeginEndBytes = !arrayContainsBoundaries;
 
@@ -235,16 +431,12 @@ void BMV51M001::sendSysEx(uint16_t length, const uint8_t* array, bool arrayConta
     {
         if (writeBeginEndBytes)
         {
-            _serial->write(MidiType::SystemExclusiveStart);
-        }
-            
-        for (unsigned i = 0; i < length; ++i)
-        {
-            _serial->write(array[i]);
+            txByte(MidiType::SystemExclusiveStart);
         }
+        txBytes(array, length);
         if (writeBeginEndBytes)
         {
-            _serial->write(MidiType::SystemExclusiveEnd);
+            txByte(MidiType::SystemExclusiveEnd);
         }
         endTransmission();
     }
@@ -256,6 +448,33 @@ void BMV51M001::sendSysEx(uint16_t length, const uint8_t* array, bool arrayConta
     
 }
 /************************************************************************* 
+Description:    Write bytes to the output as they are(a SysEx merged byte by
+                byte, see MidiMerger)
+parameter:
+    Input:      array：the bytes
+                length：the number of bytes
+Output:        
+Return:         
+Others:         Unlike the send functions, the messages held by the governor are
+                not sent first, so nothing is inserted inside a SysEx written in
+                several calls: they wait until a status byte other than 0xF0 is
+                written. A status byte cancels the transmit running status.
+**************************************************************************/
+void MidiInterfaceCore::writeRaw(const uint8_t *array, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++)
+    {
+        if (array[i] >= 0x80 && array[i] < Clock)
+        {
+            _mRunningStatus_TX = InvalidType;
+            _mThruWire = 0;
+            _mRawSysEx = (array[i] == SystemExclusiveStart);
+        }
+    }
+    txBytes(array, length);
+    endTransmission();
+}
+/************************************************************************* 
 Description:    Send a MIDI Time Code Quarter Frame.
 parameter:
     Input:      typeNibble：Message type
@@ -264,7 +483,7 @@ Output:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendTimeCodeQuarterFrame(uint8_t typeNibble, uint8_t valuesNibble)
+void MidiInterfaceCore::sendTimeCodeQuarterFrame(uint8_t typeNibble, uint8_t valuesNibble)
 {
   const uint8_t data = uint8_t((((typeNibble & 0x07) << 4) | (valuesNibble & 0x0f)));
   sendTimeCodeQuarterFrame(data); 
@@ -278,7 +497,7 @@ Output:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendTimeCodeQuarterFrame(uint8_t data)
+void MidiInterfaceCore::sendTimeCodeQuarterFrame(uint8_t data)
 {
   sendCommon(TimeCodeQuarterFrame, data);
 }
@@ -290,7 +509,7 @@ parameter:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendSongPosition(uint16_t beats)
+void MidiInterfaceCore::sendSongPosition(uint16_t beats)
 {
   sendCommon(SongPosition, beats);
 }
@@ -302,7 +521,7 @@ parameter:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendSongSelect(uint8_t songNumber)
+void MidiInterfaceCore::sendSongSelect(uint8_t songNumber)
 {
   sendCommon(SongSelect, songNumber);
 }
@@ -314,7 +533,7 @@ parameter:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendTuneRequest()
+void MidiInterfaceCore::sendTuneRequest()
 {
   sendCommon(TuneRequest);
 }
@@ -328,7 +547,7 @@ parameter:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendCommon(MidiType type, uint16_t data)
+void MidiInterfaceCore::sendCommon(MidiType type, uint16_t data)
 {
     switch (type)
     {
@@ -343,18 +562,18 @@ void BMV51M001::sendCommon(MidiType type, uint16_t data)
     }
     if (beginTransmission(type))
     {
-        _serial->write((uint8_t)type);
+        txByte((uint8_t)type);
         switch (type)
         {
             case TimeCodeQuarterFrame:
-                _serial->write(data);
+                txByte(uint8_t(data));
                 break;
             case SongPosition:
-                _serial->write(data & 0x7f);
-                _serial->write((data >> 7) & 0x7f);
+                txByte(data & 0x7f);
+                txByte((data >> 7) & 0x7f);
                 break;
             case SongSelect:
-                _serial->write(data & 0x7f);
+                txByte(data & 0x7f);
                 break;
             case TuneRequest:
                 break;
@@ -380,7 +599,7 @@ parameter:
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendRealTime(MidiType type)
+void MidiInterfaceCore::sendRealTime(MidiType type)
 {
   // Do not invalidate Running Status for real-time messages
   // as they can be interleaved within any message.
@@ -393,9 +612,20 @@ void BMV51M001::sendRealTime(MidiType type)
         case Continue:
         case ActiveSensing:
         case SystemReset:
-            if (beginTransmission(type))
+            if (_mTxQueued)
             {
-                _serial->write((uint8_t)type);
+                //Jump the queued bytes:sent at the next byte boundary,
+                //even inside a channel message or a SysEx
+                while (!_mTxRealTime.push((uint8_t)type))
+                {
+                    writeQueuedByte();
+                }
+                countWireBytes(1);
+                serviceOutput();
+            }
+            else if (beginTransmission(type))
+            {
+                txByte((uint8_t)type);
                 endTransmission();
             }
             break;
@@ -406,530 +636,1780 @@ void BMV51M001::sendRealTime(MidiType type)
     
 }
 /************************************************************************* 
-Description:    Start a Registered Parameter Number frame.
+Description:    Enable or disable the transmit running status: a channel message
+                with the same status byte as the previous one is sent without it.
 parameter:
-    Input:      number：The 14-bit number of the RPN you want to select.
-                channel：The channel on which the message will be sent (1 to 16).
+    Input:      enable：USE_RUNNING_STATUS or NOT_USE_RUNNING_STATUS(default)
+                foldNoteOff：true：send NoteOff as NoteOn with 0 velocity, so that
+                             alternating notes on/off keep one status byte
+                             (the release velocity is lost)
+                refreshTime：Resend the status byte if it has not been sent for
+                             this time in milliseconds(for receivers that joined late),
+                             0：never
     Output:         
 Return:         
-Others:         
+Others:         System Exclusive and Common messages cancel the running status
 **************************************************************************/
-void BMV51M001::beginRpn(uint16_t number, uint8_t channel)
+void MidiInterfaceCore::setRunningStatus(bool enable, bool foldNoteOff, uint16_t refreshTime)
 {
-  if (_mCurrentRpnNumber != number)
-  {
-    const uint8_t numMsb = 0x7f & (number >> 7);
-    const uint8_t numLsb = 0x7f & number;
-    sendControlChange(RPNLSB, numLsb, channel);
-    sendControlChange(RPNMSB, numMsb, channel);
-    _mCurrentRpnNumber = number;
-  }
+    _useRunningStatus = enable;
+    _mFoldNoteOff = foldNoteOff;
+    _mRunningStatusRefresh = refreshTime;
+    _mRunningStatus_TX = InvalidType;//The next message is sent with its status byte
 }
 /************************************************************************* 
-Description:    Send a 14-bit value for the currently selected RPN number.
+Description:    Get the number of status bytes not sent thanks to the running status
 parameter:
-    Input:      value：The 14-bit value of the selected RPN.
-                channel：The channel on which the message will be sent (1 to 16).
+    Input:          
     Output:         
-Return:         
+Return:         return the number of saved bytes(320us each at 31250 baud)
 Others:         
 **************************************************************************/
-void BMV51M001::sendRpnValue(uint16_t value, uint8_t channel)
+uint32_t MidiInterfaceCore::getRunningStatusSavedBytes(void)
 {
-  const uint8_t valMsb = 0x7f & (value >> 7);
-  const uint8_t valLsb = 0x7f & value;
-  sendControlChange(DataEntryMSB, valMsb, channel);
-  sendControlChange(DataEntryLSB, valLsb, channel);
+    return _mRunningStatusSaved;
 }
 /************************************************************************* 
-Description:    Send separate MSB/LSB values for the currently selected RPN number.
+Description:    Start a multi-message transaction: the following messages are
+                staged and handed to the serial port together by flush().
 parameter:
-    Input:      msb：The MSB part of the value to send. Meaning depends on RPN number.
-                lsb：The LSB part of the value to send. Meaning depends on RPN number.
-                channel：The channel on which the message will be sent (1 to 16).
+    Input:          
     Output:         
 Return:         
-Others:         
+Others:         The staging buffer is also flushed when it gets full
 **************************************************************************/
-void BMV51M001::sendRpnValue(uint8_t msb, uint8_t lsb, uint8_t channel)
+void MidiInterfaceCore::beginBatch(void)
 {
-  sendControlChange(DataEntryMSB, msb, channel);
-  sendControlChange(DataEntryLSB, lsb, channel);  
+    _mTxBatch = true;
 }
 /************************************************************************* 
-Description:    Increment the value of the currently selected RPN number by the specified amount.
+Description:    Write the staged bytes to the serial port with a single write()
+                and end the transaction started by beginBatch().
 parameter:
-    Input:      amount：The amount to add to the currently selected RPN value.
-                channel：The channel on which the message will be sent (1 to 16).
+    Input:          
     Output:         
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::sendRpnIncrement(uint8_t amount, uint8_t channel)
+void MidiInterfaceCore::flush(void)
 {
-  sendControlChange(DataIncrement, amount, channel);
+    _mTxBatch = false;
+    flushTx();
 }
 /************************************************************************* 
-Description:    Decrement the value of the currently selected RPN number by the specified amount.
+Description:    Enable or disable the queued transmit mode.
+                The bytes are kept in a library queue and written to the serial
+                port MIDI_TX_UART_DEPTH bytes ahead, so that a real-time message
+                (Clock, Start...) goes out at the next byte boundary instead of
+                waiting behind the bytes already in the serial port buffer.
 parameter:
-    Input:      amount：The amount to subtract to the currently selected RPN value.
-                channel：The channel on which the message will be sent (1 to 16).
+    Input:      enable：true：queued mode；false：direct write(default)
     Output:         
 Return:         
-Others:         
+Others:         Call serviceOutput() often(isMIDIMessageOK() calls it too).
+                The transport must report its free space with availableForWrite().
 **************************************************************************/
-void BMV51M001::sendRpnDecrement(uint8_t amount, uint8_t channel)
+void MidiInterfaceCore::setTransmitQueue(bool enable)
 {
-  sendControlChange(DataDecrement, amount, channel);
+    flushTx();
+    while (_mTxQueued && (_mTxQueue.count() != 0 || _mTxRealTime.count() != 0))
+    {
+        writeQueuedByte();//Leave the queued mode with nothing pending
+    }
+    _mTxQueued = enable;
 }
 /************************************************************************* 
-Description:    Terminate an RPN frame.
-                This will send a Null Function to deselect the currently selected RPN.
+Description:    Write the queued bytes while the serial port buffer holds
+                less than MIDI_TX_UART_DEPTH bytes(queued mode), send the
+                messages held by the governor once the wire has room
 parameter:
-    Input:      channel：The channel on which the message will be sent (1 to 16).                
+    Input:          
     Output:         
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::endRpn(uint8_t channel)
+void MidiInterfaceCore::serviceOutput(void)
 {
-  sendControlChange(RPNLSB, 0x7f, channel);
-  sendControlChange(RPNMSB, 0x7f, channel);
-  _mCurrentRpnNumber = 0xffff;  
+    if (_mGovernorCount != 0 && !_mRawSysEx && getGovernorBacklog() < MIDI_GOVERNOR_BACKLOG)
+    {
+        releaseHeldValues();
+    }
+    if (_mTxQueued)
+    {
+        writeQueuedBytes();
+    }
 }
 /************************************************************************* 
-Description:    Start a Non-Registered Parameter Number frame.
+Description:    Write the queued bytes while the serial port buffer holds
+                less than MIDI_TX_UART_DEPTH bytes(queued mode)
 parameter:
-    Input:      number：The 14-bit number of the NRPN you want to select.
-                channel：The channel on which the message will be sent (1 to 16). 
+    Input:          
     Output:         
 Return:         
-Others:         
+Others:         The size of the serial port buffer is the largest free space seen
 **************************************************************************/
-void BMV51M001::beginNrpn(uint16_t number, uint8_t channel)
+void MidiInterfaceCore::writeQueuedBytes(void)
 {
-  if (_mCurrentNrpnNumber != number)
-  {
-      const byte numMsb = 0x7f & (number >> 7);
-      const byte numLsb = 0x7f & number;
-      sendControlChange(NRPNLSB, numLsb, channel);
-      sendControlChange(NRPNMSB, numMsb, channel);
-      _mCurrentNrpnNumber = number;
-  }  
+    while (_mTxRealTime.count() != 0 || _mTxQueue.count() != 0)
+    {
+        const int space = _mWriteSpace(_mTransport);
+        if (space > _mTxUartSize)
+        {
+            _mTxUartSize = space;
+        }
+        if (_mTxUartSize - space >= MIDI_TX_UART_DEPTH)
+        {
+            break;
+        }
+        writeQueuedByte();
+    }
 }
 /************************************************************************* 
-Description:    Send a 14-bit value for the currently selected NRPN number.
+Description:    Get the number of bytes waiting in the transmit queue(queued mode)
 parameter:
-    Input:      value：The 14-bit value of the selected NRPN.
-                channel：The channel on which the message will be sent (1 to 16). 
+    Input:          
     Output:         
-Return:         
+Return:         the number of bytes, real-time bytes included
 Others:         
 **************************************************************************/
-void BMV51M001::sendNrpnValue(uint16_t value, uint8_t channel)
+uint8_t MidiInterfaceCore::getTransmitQueueCount(void)
 {
-  const byte valMsb = 0x7f & (value >> 7);
-  const byte valLsb = 0x7f & value;
-  sendControlChange(DataEntryMSB, valMsb, channel);
-  sendControlChange(DataEntryLSB, valLsb, channel);  
+    return _mTxQueue.count() + _mTxRealTime.count();
 }
 /************************************************************************* 
-Description:    Send separate MSB/LSB values for the currently selected NRPN number.
+Description:    Enable or disable the output bandwidth governor.
+                The time each byte takes on the wire(MIDI_BYTE_TIME) is added
+                up to estimate the bytes not sent yet. From MIDI_GOVERNOR_BACKLOG
+                bytes, the Control Change, Pitch Bend and AfterTouch messages are
+                held, and a newer value of a held(channel, controller) replaces
+                the older one, so a fast knob or wheel never blocks loop().
 parameter:
-    Input:      msb：The MSB part of the value to send. Meaning depends on NRPN number.
-                lsb：The LSB part of the value to send. Meaning depends on NRPN number.
-                channel：The channel on which the message will be sent (1 to 16). 
+    Input:      enable：true：governor on；false：off(default), the held messages are sent
     Output:         
 Return:         
-Others:         
+Others:         Notes, SysEx and the other messages are sent in order: the held
+                values are sent first. The held values are also sent by
+                serviceOutput()(isMIDIMessageOK() calls it) once the backlog
+                is below MIDI_GOVERNOR_BACKLOG bytes. The parameter number
+                controllers and the channel mode messages are never held.
 **************************************************************************/
-void BMV51M001::sendNrpnValue(uint8_t msb, uint8_t lsb, uint8_t channel)
+void MidiInterfaceCore::setGovernor(bool enable)
 {
-  sendControlChange(DataEntryMSB, msb, channel);
-  sendControlChange(DataEntryLSB, lsb, channel);  
+    if (!enable && _mGovernorCount != 0)
+    {
+        releaseHeldValues();
+    }
+    _mGovernor = enable;
+    _mWireFree = micros();
+    _mGovernorDropped = 0;
 }
 /************************************************************************* 
-Description:    Increment the value of the currently selected NRPN number by the specified amount.
+Description:    Get the estimated wire backlog(governor on)
 parameter:
-    Input:      amount：The amount to add to the currently selected NRPN value.
-                channel：The channel on which the message will be sent (1 to 16). 
+    Input:          
     Output:         
-Return:         
+Return:         the number of bytes handed to the serial port and not on the wire yet
 Others:         
 **************************************************************************/
-void BMV51M001::sendNrpnIncrement(uint8_t amount, uint8_t channel)
+uint16_t MidiInterfaceCore::getGovernorBacklog(void)
 {
-  sendControlChange(DataIncrement, amount, channel);
+    const long backlog = long(_mWireFree - micros());
+    return (backlog > 0) ? uint16_t(backlog / MIDI_BYTE_TIME) : 0;
 }
 /************************************************************************* 
-Description:    Decrement the value of the currently selected NRPN number by the specified amount.
+Description:    Get the number of messages held by the governor
 parameter:
-    Input:      amount：The amount to subtract to the currently selected NRPN value.
-                channel：The channel on which the message will be sent (1 to 16).
+    Input:          
     Output:         
-Return:         
+Return:         the number of held messages(MIDI_GOVERNOR_SLOTS at most)
 Others:         
 **************************************************************************/
-void BMV51M001::sendNrpnDecrement(uint8_t amount, uint8_t channel)
+uint8_t MidiInterfaceCore::getGovernorHeldCount(void)
 {
-  sendControlChange(DataDecrement, amount, channel);
+    return _mGovernorCount;
 }
 /************************************************************************* 
-Description:    Terminate an NRPN frame.
-                This will send a Null Function to deselect the currently selected NRPN.
+Description:    Get the number of values the governor replaced by a newer one
 parameter:
-    Input:      channel：The channel on which the message will be sent (1 to 16).  
+    Input:          
+    Output:         
+Return:         the number of intermediate values not sent
+Others:         Cleared by setGovernor()
+**************************************************************************/
+uint32_t MidiInterfaceCore::getGovernorDroppedCount(void)
+{
+    return _mGovernorDropped;
+}
+/************************************************************************* 
+Description:    Add bytes handed to the serial port to the estimated wire backlog
+parameter:
+    Input:      length：the number of bytes
     Output:         
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::endNrpn(uint8_t channel)
+void MidiInterfaceCore::countWireBytes(uint16_t length)
 {
-  sendControlChange(NRPNLSB, 0x7f, channel);
-  sendControlChange(NRPNMSB, 0x7f, channel);
-  _mCurrentNrpnNumber = 0xffff;
+    if (_mGovernor)
+    {
+        const unsigned long now = micros();
+        if (long(_mWireFree - now) < 0)
+        {
+            _mWireFree = now;//The wire was idle
+        }
+        _mWireFree += (unsigned long)length * MIDI_BYTE_TIME;
+    }
 }
-
-
-
-
-/************************************MIDI IN***************************************/
-
 /************************************************************************* 
-Description:    Read messages from the serial port using the main input channel.
+Description:    Hold a continuous message while the wire is saturated
 parameter:
-    Input:          
+    Input:      type：the message type
+                data1：MIDI Message data byte 1
+                data2：MIDI Message data byte 2
+                channel：The channel of the message(1~16)
     Output:         
-Return:         1: if a valid MIDI message
-                0: false if not.
-                A valid message is a message that matches the input channel.
+Return:         true：the message is held(or has replaced a held value)
+                false：the message has to be sent now
 Others:         
 **************************************************************************/
-bool BMV51M001::isMIDIMessageOK(void)
+bool MidiInterfaceCore::holdValue(MidiType type, uint8_t data1, uint8_t data2, uint8_t channel)
 {
-    if (_mInputChannel >= MIDI_CHANNEL_OFF)
-        return false; // MIDI Input disabled.
-
-    if (!parse())
+    const bool keyed = (type == ControlChange || type == AfterTouchPoly);//one value per controller or note
+    if (!(keyed || type == PitchBend || type == AfterTouchChannel)
+    ||  (type == ControlChange && !MidiControllerCache::isCached(data1))
+    ||  getGovernorBacklog() < MIDI_GOVERNOR_BACKLOG)
     {
         return false;
     }
-
-    const bool channelMatch = inputFilter(_mInputChannel);
-    if (channelMatch)
+    for (uint8_t i = 0; i < _mGovernorCount; i++)
     {
-        launchCallback();
+        MidiEvent &held = _mGovernorHeld[i];
+        if (held.type == type && held.channel == channel && (!keyed || held.data1 == data1))
+        {
+            held.data1 = data1;
+            held.data2 = data2;
+            _mGovernorDropped++;
+            return true;
+        }
     }
-        
-    return channelMatch;
+    if (_mGovernorCount >= MIDI_GOVERNOR_SLOTS)
+    {
+        return false;//No room: sent after the held values, as without governor
+    }
+    MidiEvent &held = _mGovernorHeld[_mGovernorCount++];
+    held.type = type;
+    held.channel = channel;
+    held.data1 = data1;
+    held.data2 = data2;
+    return true;
 }
 /************************************************************************* 
-Description:    Gets the received MIDI message.
+Description:    Send the messages held by the governor, in arrival order
 parameter:
-    Input:      array[]:Stores the received MIDI message.
+    Input:          
     Output:         
 Return:         
-Others:         
+Others:         The controller cache has already taken these values
 **************************************************************************/
-void BMV51M001::getMIDIMessage(uint8_t array[])
+void MidiInterfaceCore::releaseHeldValues(void)
 {
-    if(checkMessageValid())
+    MidiControllerCache *cache = _mControllerCache;
+    _mControllerCache = nullptr;
+    _mGovernorRelease = true;
+    for (uint8_t i = 0; i < _mGovernorCount; i++)
     {
-        if((_midiMessage.type == SystemExclusiveStart)
-            ||  (_midiMessage.type == SystemExclusiveEnd))
-        {
-            memcpy(array, _midiMessage.sysexArray, _midiMessage.getSysExSize());
-        }
-        else
-        {
-          array[0] = _midiMessage.type;
-          array[1] = _midiMessage.data1;
-          array[2] = _midiMessage.data2;
-          array[3] = _midiMessage.channel;
-        }
+        send(_mGovernorHeld[i].type, _mGovernorHeld[i].data1, _mGovernorHeld[i].data2, _mGovernorHeld[i].channel);
     }
+    _mGovernorCount = 0;
+    _mGovernorRelease = false;
+    _mControllerCache = cache;
 }
 /************************************************************************* 
-Description:    MIDI parser
+Description:    Track the active notes: each NoteOn sets the bit of its note,
+                each NoteOff(or NoteOn with 0 velocity) clears it
+parameter:
+    Input:      tracker：the note tracker, nullptr：no tracking(default)
+                sources：MIDI_TRACK_SENT：notes sent by send()
+                         MIDI_TRACK_RECEIVED：notes received(when their callbacks are launched)
+    Output:         
+Return:         
+Others:         One tracker can be shared by several interfaces(keyboard thru...)
+**************************************************************************/
+void MidiInterfaceCore::setNoteTracker(MidiNoteTracker *tracker, uint8_t sources)
+{
+    _mNoteTracker = tracker;
+    _mNoteSources = sources;
+    updateHooks();
+}
+/************************************************************************* 
+Description:    Turn off the notes held in the note tracker: one NoteOff per
+                held note, instead of 16x128 NoteOffs or an All Notes Off
+                ignored by many receivers
 parameter:
     Input:          
     Output:         
-Return:         false：No data available or Complete MIDI message reception is not complete
-				        true：Complete MIDI message reception is complete
-Others:         
+Return:         
+Others:         The NoteOffs of a channel share one status byte(running status),
+                whatever setRunningStatus(). The tracker is cleared.
 **************************************************************************/
-bool BMV51M001::parse(void)
+void MidiInterfaceCore::panic(void)
 {
-    if (_serial->available() == 0)//The serial port did not receive the message
-    {
-        return false;
-    }
-
-    const uint8_t extracted =  _serial->read();//Extract data from the serial port
-
-        // Ignore Undefined
-    if (extracted == Undefined_FD)
+    if (_mNoteTracker == nullptr || _mNoteTracker->getActiveChannels() == 0)
     {
-        return (MidiMessage::Use1ByteParsing) ? false : parse();
+        return;
     }
-    
-    if (_mPendingMessageIndex == 0)//Starts new message reception without pending messages
+    if (beginTransmission(NoteOff))
     {
-        _mPendingMessage[0] = extracted;
-
-        // Check for running status first
-        if (isChannelMessage(getTypeFromStatusByte(_mRunningStatus_RX)))
+        uint8_t status = InvalidType;
+        for (uint8_t channel = 1; channel <= 16; channel++)
         {
-            // Only these types allow Running Status
-
-            // If the status byte is not received, prepend it
-            // to the pending message
-
-            if (extracted < 0x80)
+            if (!(_mNoteTracker->getActiveChannels() & (1 << (channel - 1))))
             {
-                _mPendingMessage[0]   = _mRunningStatus_RX;
-                _mPendingMessage[1]   = extracted;
-                _mPendingMessageIndex = 1;
+                continue;
+            }
+            status = uint8_t(NoteOff | (channel - 1));
+            txByte(status);
+            for (uint8_t note = _mNoteTracker->findNote(channel); note < 128; note = _mNoteTracker->findNote(channel, note + 1))
+            {
+                txByte(note);
+                txByte(0);
             }
-            // Else: well, we received another status byte,
-            // so the running status does not apply here.
-            // It will be updated upon completion of this message.
-
         }
-
-        const MidiType pendingType = getTypeFromStatusByte(_mPendingMessage[0]);
-
-        switch (pendingType)
-        {
-            // 1 byte messages
-            case Start:
-            case Continue:
-            case Stop:
-            case Clock:
-            case ActiveSensing:
-            case SystemReset:
-            case TuneRequest:
-                // Handle the message type directly here.
-                _midiMessage.type    = pendingType;
-                _midiMessage.channel = 0;
-                _midiMessage.data1   = 0;
-                _midiMessage.data2   = 0;
-                _midiMessage.valid   = true;
-
-                // Do not reset all input attributes, Running Status must remain unchanged.
-                // We still need to reset these
-                _mPendingMessageIndex = 0;
-                _mMidiDatabytes = 0;
-
-                return true;
-                break;
-            //2 bytes messages
-            case ProgramChange:
-            case AfterTouchChannel:
-            case TimeCodeQuarterFrame:
-            case SongSelect:
-                _mMidiDatabytes = 1;
-                break;
-            
-            //3 bytes messages
-            case NoteOn:
-            case NoteOff:
-            case ControlChange:
-            case PitchBend:
-            case AfterTouchPoly:
-            case SongPosition:
-                _mMidiDatabytes = 2;
-                break;   
-
-            case SystemExclusiveStart:
-            case SystemExclusiveEnd:
-                // The message can be any length
-                // between 3 and MidiMessage::sSysExMaxSize bytes
-                _mMidiDatabytes = SYS_EX_MAXSIZE - 1;
-                _mRunningStatus_RX = InvalidType;
-                _midiMessage.sysexArray[0] = pendingType;
-                break;
-            case InvalidType:
-            default:
-                resetInput();
-                return false;
-                break;
+        endTransmission();
+        _mRunningStatus_TX = status;//The last status byte is on the wire
+        _mRunningStatusTime = millis();
+    }
+    _mNoteTracker->clear();
+}
+/************************************************************************* 
+Description:    Drop the Control Change, Program Change, Pitch Bend and channel
+                AfterTouch sends that repeat the last value sent on their channel
+parameter:
+    Input:      cache：the controller cache, nullptr：every send is written(default)
+    Output:         
+Return:         
+Others:         Controller surfaces can send all their knobs on each scan,
+                only the changes reach the wire
+**************************************************************************/
+void MidiInterfaceCore::setControllerCache(MidiControllerCache *cache)
+{
+    _mControllerCache = cache;
+    _mCacheSaved = 0;
+}
+/************************************************************************* 
+Description:    Send again every value held in the controller cache(after the
+                receiver has been switched on or reset)
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Values never sent are skipped
+**************************************************************************/
+void MidiInterfaceCore::resendAll(void)
+{
+    MidiControllerCache *cache = _mControllerCache;
+    if (cache == nullptr)
+    {
+        return;
+    }
+    _mControllerCache = nullptr;//Bypass the cache, the values do not change
+    for (uint8_t channel = 1; channel <= 16; channel++)
+    {
+        for (uint8_t controlNumber = 0; controlNumber <= 32; controlNumber += 32)//Bank Select first
+        {
+            if (cache->getControl(channel, controlNumber) != MIDI_CACHE_UNKNOWN)
+            {
+                send(ControlChange, controlNumber, cache->getControl(channel, controlNumber), channel);
+            }
+        }
+        if (cache->getProgram(channel) != MIDI_CACHE_UNKNOWN)
+        {
+            send(ProgramChange, cache->getProgram(channel), 0, channel);
+        }
+        for (uint8_t controlNumber = 1; controlNumber < 128; controlNumber++)
+        {
+            if (controlNumber != 32 && cache->getControl(channel, controlNumber) != MIDI_CACHE_UNKNOWN)
+            {
+                send(ControlChange, controlNumber, cache->getControl(channel, controlNumber), channel);
+            }
+        }
+        if (cache->getAfterTouch(channel) != MIDI_CACHE_UNKNOWN)
+        {
+            send(AfterTouchChannel, cache->getAfterTouch(channel), 0, channel);
+        }
+        if (cache->getPitchBend(channel) != MIDI_CACHE_UNKNOWN_14BIT)
+        {
+            send(PitchBend, cache->getPitchBend(channel) & 0x7f, cache->getPitchBend(channel) >> 7, channel);
+        }
+    }
+    _mControllerCache = cache;
+}
+/************************************************************************* 
+Description:    Get the number of bytes the controller cache kept off the wire
+parameter:
+    Input:          
+    Output:         
+Return:         the number of bytes(status bytes included when they would have been sent)
+Others:         Cleared by setControllerCache()
+**************************************************************************/
+uint32_t MidiInterfaceCore::getCacheSavedBytes(void)
+{
+    return _mCacheSaved;
+}
+/************************************************************************* 
+Description:    Start a Registered Parameter Number frame.
+parameter:
+    Input:      number：The 14-bit number of the RPN you want to select.
+                channel：The channel on which the message will be sent (1 to 16).
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::beginRpn(uint16_t number, uint8_t channel)
+{
+  selectParameter(MIDI_PARAMETER_RPN, number, channel);
+}
+/************************************************************************* 
+Description:    Send a 14-bit value for the currently selected RPN number.
+parameter:
+    Input:      value：The 14-bit value of the selected RPN.
+                channel：The channel on which the message will be sent (1 to 16).
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::sendRpnValue(uint16_t value, uint8_t channel)
+{
+  const uint8_t valMsb = 0x7f & (value >> 7);
+  const uint8_t valLsb = 0x7f & value;
+  sendControlChange(DataEntryMSB, valMsb, channel);
+  sendControlChange(DataEntryLSB, valLsb, channel);
+}
+/************************************************************************* 
+Description:    Send separate MSB/LSB values for the currently selected RPN number.
+parameter:
+    Input:      msb：The MSB part of the value to send. Meaning depends on RPN number.
+                lsb：The LSB part of the value to send. Meaning depends on RPN number.
+                channel：The channel on which the message will be sent (1 to 16).
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::sendRpnValue(uint8_t msb, uint8_t lsb, uint8_t channel)
+{
+  sendControlChange(DataEntryMSB, msb, channel);
+  sendControlChange(DataEntryLSB, lsb, channel);  
+}
+/************************************************************************* 
+Description:    Increment the value of the currently selected RPN number by the specified amount.
+parameter:
+    Input:      amount：The amount to add to the currently selected RPN value.
+                channel：The channel on which the message will be sent (1 to 16).
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::sendRpnIncrement(uint8_t amount, uint8_t channel)
+{
+  sendControlChange(DataIncrement, amount, channel);
+}
+/************************************************************************* 
+Description:    Decrement the value of the currently selected RPN number by the specified amount.
+parameter:
+    Input:      amount：The amount to subtract to the currently selected RPN value.
+                channel：The channel on which the message will be sent (1 to 16).
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::sendRpnDecrement(uint8_t amount, uint8_t channel)
+{
+  sendControlChange(DataDecrement, amount, channel);
+}
+/************************************************************************* 
+Description:    Terminate an RPN frame.
+                This will send a Null Function to deselect the currently selected RPN.
+parameter:
+    Input:      channel：The channel on which the message will be sent (1 to 16).                
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::endRpn(uint8_t channel)
+{
+  sendControlChange(RPNLSB, 0x7f, channel);
+  sendControlChange(RPNMSB, 0x7f, channel);
+}
+/************************************************************************* 
+Description:    Set a Registered Parameter Number: select it if it is not the
+                parameter selected on the channel, then send the 14-bit value
+parameter:
+    Input:      number：The 14-bit number of the RPN.
+                value：The 14-bit value of the RPN.
+                channel：The channel on which the message will be sent (1 to 16).
+    Output:         
+Return:         
+Others:         2 Control Change messages when the RPN is already selected
+**************************************************************************/
+void MidiInterfaceCore::sendRpn(uint16_t number, uint16_t value, uint8_t channel)
+{
+  selectParameter(MIDI_PARAMETER_RPN, number, channel);
+  sendRpnValue(value, channel);
+}
+/************************************************************************* 
+Description:    Start a Non-Registered Parameter Number frame.
+parameter:
+    Input:      number：The 14-bit number of the NRPN you want to select.
+                channel：The channel on which the message will be sent (1 to 16). 
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::beginNrpn(uint16_t number, uint8_t channel)
+{
+  selectParameter(MIDI_PARAMETER_NRPN, number, channel);
+}
+/************************************************************************* 
+Description:    Send a 14-bit value for the currently selected NRPN number.
+parameter:
+    Input:      value：The 14-bit value of the selected NRPN.
+                channel：The channel on which the message will be sent (1 to 16). 
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::sendNrpnValue(uint16_t value, uint8_t channel)
+{
+  const uint8_t valMsb = 0x7f & (value >> 7);
+  const uint8_t valLsb = 0x7f & value;
+  sendControlChange(DataEntryMSB, valMsb, channel);
+  sendControlChange(DataEntryLSB, valLsb, channel);  
+}
+/************************************************************************* 
+Description:    Send separate MSB/LSB values for the currently selected NRPN number.
+parameter:
+    Input:      msb：The MSB part of the value to send. Meaning depends on NRPN number.
+                lsb：The LSB part of the value to send. Meaning depends on NRPN number.
+                channel：The channel on which the message will be sent (1 to 16). 
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::sendNrpnValue(uint8_t msb, uint8_t lsb, uint8_t channel)
+{
+  sendControlChange(DataEntryMSB, msb, channel);
+  sendControlChange(DataEntryLSB, lsb, channel);  
+}
+/************************************************************************* 
+Description:    Increment the value of the currently selected NRPN number by the specified amount.
+parameter:
+    Input:      amount：The amount to add to the currently selected NRPN value.
+                channel：The channel on which the message will be sent (1 to 16). 
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::sendNrpnIncrement(uint8_t amount, uint8_t channel)
+{
+  sendControlChange(DataIncrement, amount, channel);
+}
+/************************************************************************* 
+Description:    Decrement the value of the currently selected NRPN number by the specified amount.
+parameter:
+    Input:      amount：The amount to subtract to the currently selected NRPN value.
+                channel：The channel on which the message will be sent (1 to 16).
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::sendNrpnDecrement(uint8_t amount, uint8_t channel)
+{
+  sendControlChange(DataDecrement, amount, channel);
+}
+/************************************************************************* 
+Description:    Terminate an NRPN frame.
+                This will send a Null Function to deselect the currently selected NRPN.
+parameter:
+    Input:      channel：The channel on which the message will be sent (1 to 16).  
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::endNrpn(uint8_t channel)
+{
+  sendControlChange(NRPNLSB, 0x7f, channel);
+  sendControlChange(NRPNMSB, 0x7f, channel);
+}
+/************************************************************************* 
+Description:    Set a Non-Registered Parameter Number: select it if it is not the
+                parameter selected on the channel, then send the 14-bit value
+parameter:
+    Input:      number：The 14-bit number of the NRPN.
+                value：The 14-bit value of the NRPN.
+                channel：The channel on which the message will be sent (1 to 16).
+    Output:         
+Return:         
+Others:         2 Control Change messages when the NRPN is already selected
+**************************************************************************/
+void MidiInterfaceCore::sendNrpn(uint16_t number, uint16_t value, uint8_t channel)
+{
+  selectParameter(MIDI_PARAMETER_NRPN, number, channel);
+  sendNrpnValue(value, channel);
+}
+/************************************************************************* 
+Description:    Select a parameter: send only the parameter number bytes
+                that differ from the ones last sent on the channel
+parameter:
+    Input:      select：MIDI_PARAMETER_RPN or MIDI_PARAMETER_NRPN
+                number：The 14-bit number of the parameter.
+                channel：The channel on which the message will be sent (1 to 16).
+    Output:         
+Return:         
+Others:         Both bytes are sent when the channel switches between RPN and NRPN.
+                The bytes sent are recorded by send().
+**************************************************************************/
+void MidiInterfaceCore::selectParameter(uint8_t select, uint16_t number, uint8_t channel)
+{
+  if (channel >= MIDI_CHANNEL_OFF || channel == MIDI_CHANNEL_OMNI)
+  {
+    return;
+  }
+  const uint8_t index = (channel - 1) & 0x0f;
+  const uint8_t numMsb = 0x7f & (number >> 7);
+  const uint8_t numLsb = 0x7f & number;
+  const bool selected = (_mParameterSelect[index] == select);
+  if (!selected || _mParameterLsb[index] != numLsb)
+  {
+    sendControlChange(select == MIDI_PARAMETER_RPN ? RPNLSB : NRPNLSB, numLsb, channel);
+  }
+  if (!selected || _mParameterMsb[index] != numMsb)
+  {
+    sendControlChange(select == MIDI_PARAMETER_RPN ? RPNMSB : NRPNMSB, numMsb, channel);
+  }
+}
+/************************************************************************* 
+Description:    Forget the parameter selected on each channel: the next
+                beginRpn()/beginNrpn() sends both number bytes
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::resetParameterSelect(void)
+{
+  memset(_mParameterSelect, MIDI_PARAMETER_NONE, sizeof(_mParameterSelect));
+  memset(_mParameterMsb, 0xff, sizeof(_mParameterMsb));
+  memset(_mParameterLsb, 0xff, sizeof(_mParameterLsb));
+}
+
+
+
+
+/************************************************************************* 
+Description:    Called before each message: nothing to prepare, the bytes are staged
+parameter:
+    Input:      type：the message type
+    Output:         
+Return:         true：the message can be sent
+Others:         A message other than real-time takes the wire status from the thru
+**************************************************************************/
+bool MidiInterfaceCore::beginTransmission(MidiType type)
+{
+    if (type < Clock)
+    {
+        _mThruWire = 0;
+        _mRawSysEx = false;
+        if (_mGovernorCount != 0 && !_mGovernorRelease)
+        {
+            releaseHeldValues();//The held values go before any later message
+        }
+    }
+    return true;
+}
+/************************************************************************* 
+Description:    Called after each message: flush it unless a batch is open
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::endTransmission(void)
+{
+    if (!_mTxBatch)
+    {
+        flushTx();
+    }
+}
+/************************************************************************* 
+Description:    Stage one byte to send
+parameter:
+    Input:      data：the byte
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::txByte(uint8_t data)
+{
+    if (_mTxLength >= MIDI_TX_BUFFER_SIZE)
+    {
+        flushTx();
+    }
+    _mTxBuffer[_mTxLength++] = data;
+}
+/************************************************************************* 
+Description:    Stage several bytes to send
+parameter:
+    Input:      array：the bytes
+                length：the number of bytes
+    Output:         
+Return:         
+Others:         A block larger than the free space is written directly
+                after the staged bytes, without an extra copy
+**************************************************************************/
+void MidiInterfaceCore::txBytes(const uint8_t *array, uint16_t length)
+{
+    if (length <= MIDI_TX_BUFFER_SIZE - _mTxLength)
+    {
+        memcpy(&_mTxBuffer[_mTxLength], array, length);
+        _mTxLength += length;
+    }
+    else if (_mTxQueued)
+    {
+        flushTx();
+        countWireBytes(length);
+        queueTx(array, length);
+    }
+    else
+    {
+        flushTx();
+        countWireBytes(length);
+        _mWrite(_mTransport, array, length);
+    }
+}
+/************************************************************************* 
+Description:    Write the staged bytes to the serial port
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::flushTx(void)
+{
+    if (_mTxLength != 0)
+    {
+        countWireBytes(_mTxLength);
+        if (_mTxQueued)
+        {
+            queueTx(_mTxBuffer, _mTxLength);
+        }
+        else
+        {
+            _mWrite(_mTransport, _mTxBuffer, _mTxLength);
+        }
+        _mTxLength = 0;
+    }
+}
+/************************************************************************* 
+Description:    Append bytes to the transmit queue(queued mode)
+parameter:
+    Input:      array：the bytes
+                length：the number of bytes
+    Output:         
+Return:         
+Others:         When the queue is full the oldest bytes are written,
+                waiting for the serial port like a direct write
+**************************************************************************/
+void MidiInterfaceCore::queueTx(const uint8_t *array, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++)
+    {
+        while (!_mTxQueue.push(array[i]))
+        {
+            writeQueuedBytes();//Queue full: wait for the serial port, which keeps MIDI_TX_UART_DEPTH bytes at most
+        }
+    }
+    serviceOutput();
+}
+/************************************************************************* 
+Description:    Write the next queued byte to the serial port, real-time bytes first
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::writeQueuedByte(void)
+{
+    uint8_t data;
+    if (_mTxRealTime.pop(data) || _mTxQueue.pop(data))
+    {
+        _mWrite(_mTransport, &data, 1);
+    }
+}
+
+/************************************MIDI IN***************************************/
+
+/************************************************************************* 
+Description:    Enable or disable the burst-drain receive mode.
+                In drain mode every call of isMIDIMessageOK() parses all the bytes
+                currently buffered by the serial port, launches the callbacks of
+                each completed message and queues it for polling.
+parameter:
+    Input:      enable：true：drain mode；false：parse one byte per call(default)
+                byteBudget：Maximum bytes parsed per call, 0：no limit
+                timeBudget：Maximum time spent per call in microseconds, 0：no limit
+    Output:         
+Return:         
+Others:         isMIDIMessageOK() returns true while queued messages remain,
+                the getters read the message popped from the queue. The drain
+                stops while the queue is full or a queued SysEx is not read yet,
+                the next bytes wait in the serial port buffer(nothing is dropped).
+**************************************************************************/
+void MidiInterfaceCore::setDrainMode(bool enable, uint16_t byteBudget, uint16_t timeBudget)
+{
+    _mDrainMode = enable;
+    _mDrainByteBudget = byteBudget;
+    _mDrainTimeBudget = timeBudget;
+    resetQueue();
+}
+/************************************************************************* 
+Description:    Enable or disable the interrupt receive mode.
+                In interrupt mode the bytes are parsed by serviceInput(), called
+                from serialEvent() or an interrupt, into a lock-free ring of compact
+                messages. isMIDIMessageOK() or pop() read them back in loop().
+parameter:
+    Input:      enable：true：interrupt mode；false：parse in isMIDIMessageOK()(default)
+    Output:         
+Return:         
+Others:         Callbacks are launched by isMIDIMessageOK(), never from serviceInput().
+                A queued SysEx keeps the SysEx buffer until the next isMIDIMessageOK()
+                or pop() after it is read: a SysEx starting before is dropped(counted
+                by getQueueOverflowCount()), as is the rest of a SysEx larger than
+                SYS_EX_MAXSIZE whose first part is still queued.
+**************************************************************************/
+void MidiInterfaceCore::setInterruptMode(bool enable)
+{
+    _mInterruptMode = false;
+    resetQueue();
+    _mInterruptMode = enable;
+}
+/************************************************************************* 
+Description:    Enable or disable the input coalescing: when the handlers fall
+                behind, the queued Control Change, Pitch Bend and AfterTouch
+                messages followed by a newer value of the same(channel, controller)
+                are skipped, so one pass over the queue catches up with the present
+parameter:
+    Input:      enable：true：latest value wins；false：every message is delivered(default)
+    Output:         
+Return:         
+Others:         Applies to the queued messages: isMIDIMessageOK() in interrupt
+                mode(before the callbacks), the polled messages of the drain mode
+                and pop(). Notes, real-time, the pedals(controllers 64 to 69) and
+                the parameter number controllers are never skipped, and a value
+                is not skipped for a newer one behind a note or a Program Change
+                of its channel.
+**************************************************************************/
+void MidiInterfaceCore::setInputCoalescing(bool enable)
+{
+    _mCoalesce = enable;
+    _mCoalesced = 0;
+}
+/************************************************************************* 
+Description:    Get the number of queued messages skipped by the input coalescing
+parameter:
+    Input:          
+    Output:         
+Return:         the number of outdated values not delivered
+Others:         Cleared by setInputCoalescing()
+**************************************************************************/
+uint32_t MidiInterfaceCore::getCoalescedCount(void)
+{
+    return _mCoalesced;
+}
+/************************************************************************* 
+Description:    Read the oldest message of the receive ring(consumer side)
+parameter:
+    Input:          
+    Output:     message：the compact message
+Return:         false：No message waiting
+                true：A message has been read
+Others:         No callback is launched
+**************************************************************************/
+bool MidiInterfaceCore::pop(MidiPacket &message)
+{
+    uint32_t time;
+    return popLatest(message, time);
+}
+/************************************************************************* 
+Description:    Get the number of messages dropped because the receive queue was full
+parameter:
+    Input:          
+    Output:         
+Return:         return the number of dropped messages
+Others:         SysEx dropped because a queued SysEx still held the SysEx buffer
+                are counted too
+**************************************************************************/
+uint16_t MidiInterfaceCore::getQueueOverflowCount(void)
+{
+    return _mRxQueue.getOverflowCount() + _mSysExDropped;
+}
+/************************************************************************* 
+Description:    Gets the received MIDI message.
+parameter:
+    Input:      array[]:Stores the received MIDI message.
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::getMIDIMessage(uint8_t array[])
+{
+    if(checkMessageValid())
+    {
+        if((_midiMessage.type == SystemExclusiveStart)
+            ||  (_midiMessage.type == SystemExclusiveEnd))
+        {
+            memcpy(array, _mSysExBuffer, _midiMessage.getSysExSize());
+        }
+        else
+        {
+          array[0] = _midiMessage.type;
+          array[1] = _midiMessage.data1;
+          array[2] = _midiMessage.data2;
+          array[3] = _midiMessage.channel;
+        }
+    }
+}
+/************************************************************************* 
+Description:    Feed one received byte to the MIDI parser
+parameter:
+    Input:      extracted：the byte read from the serial port
+    Output:         
+Return:         false：Complete MIDI message reception is not complete
+                true：Complete MIDI message reception is complete
+Others:         
+**************************************************************************/
+bool MidiInterfaceCore::parseByte(uint8_t extracted)
+{
+    if (_mSysExSplit && _mSysExBusy)//The first part is still queued: drop the rest
+    {
+        _mSysExSplit = false;
+        _mSysExDropped++;
+        resetInput();
+    }
+    if (_mSysExSplit)//Continue a SysEx larger than the buffer
+    {
+        _mSysExArray[0] = SystemExclusiveEnd;
+        _mSysExArray[1] = _mSysExCarry;
+        _mPendingMessageIndex = 2;
+        _mSysExSplit = false;
+    }
+
+    if (extracted >= 0x80)//Status byte: a single table load gives type, length and class
+    {
+        const uint16_t entry = pgm_read_word(&sMidiStatusTable[extracted]);
+        const MidiType statusType = MidiType(entry & 0xff);
+        const uint8_t statusFlags = uint8_t(entry >> 8);
+
+        if (statusFlags & MIDI_STATUS_REALTIME)
+        {
+            // Real Time messages can be interleaved anywhere, even in the
+            // middle of another message: the pending message and the
+            // running status are left as is, it will be completed on next calls.
+            if (statusType == InvalidType || !(_mTypeMask & (1UL << midiTypeIndex(extracted))))
+            {
+                return false;//Ignore Undefined_F9, Undefined_FD and the filtered types
+            }
+            _mParsed.type    = statusType;
+            _mParsed.channel = 0;
+            _mParsed.data1   = 0;
+            _mParsed.data2   = 0;
+            _mParsedTime = (_mClock != nullptr) ? _mClock() : 0;
+            return true;
+        }
+
+        if ((_mPendingMessageIndex != 0) && (_mPendingFlags & MIDI_STATUS_SYSEX)
+            && (statusFlags & MIDI_STATUS_SYSEX))
+        {
+            if (_mSysExStream != nullptr)
+            {
+                streamSysExByte(extracted, true);
+                resetInput();
+                return true;
+            }
+            // Store the last byte (EOX:F7)sysexArray{f0 xx xx f7}
+            _mSysExArray[_mPendingMessageIndex++] = extracted;
+            _mParsed.type = SystemExclusive;
+
+            // Get length
+            _mParsed.data1   = _mPendingMessageIndex & 0xff; // LSB
+            _mParsed.data2   = uint8_t(_mPendingMessageIndex >> 8);   // MSB
+            _mParsed.channel = 0;
+            _mParsedTime = _mPendingTime;
+
+            resetInput();
+
+            return true;
+        }
+
+        // Filtered out by the type or channel mask: the message and its
+        // running status data bytes are ignored until the next status byte
+        if (!(_mTypeMask & (1UL << midiTypeIndex(extracted)))
+            || ((statusFlags & MIDI_STATUS_CHANNEL) && !(_mChannelMask & (1U << (extracted & 0x0f)))))
+        {
+            resetInput();
+            return false;
+        }
+
+        // Any other status byte starts a new message(an uncompleted one is dropped)
+        if (_mClock != nullptr)
+        {
+            _mPendingTime = _mClock();
+        }
+        _mPendingMessage[0] = extracted;
+        _mPendingType = statusType;
+        _mPendingFlags = statusFlags;
+        _mMidiDatabytes = statusFlags & MIDI_STATUS_LENGTH;
+        _mRunningStatus_RX = InvalidType;//It will be updated upon completion of this message.
+
+        if ((statusType == InvalidType) || (statusType == SystemExclusiveEnd))
+        {
+            resetInput();//Undefined or EOX outside a SysEx
+            return false;
+        }
+        if ((statusFlags & MIDI_STATUS_SYSEX) && _mSysExBusy)
+        {
+            // A queued SysEx is still in the buffer: this one is dropped,
+            // its data bytes are ignored(no running status)
+            _mSysExDropped++;
+            resetInput();
+            return false;
+        }
+        if (statusFlags & MIDI_STATUS_SYSEX)
+        {
+            // The message can be any length
+            // between 3 and SYS_EX_MAXSIZE bytes
+            _mMidiDatabytes = SYS_EX_MAXSIZE - 1;
+            if (_mSysExStream != nullptr)
+            {
+                _mSysExLength = 0;
+                _mSysExFirst = true;
+                streamSysExByte(extracted, false);
+            }
+            else
+            {
+                _mSysExArray[0] = extracted;
+            }
+        }
+        else if (_mMidiDatabytes == 0)
+        {
+            // Tune Request: 1 byte message
+            _mParsed.type    = statusType;
+            _mParsed.channel = 0;
+            _mParsed.data1   = 0;
+            _mParsed.data2   = 0;
+            _mParsedTime = _mPendingTime;
+            _mPendingMessageIndex = 0;
+            return true;
+        }
+        _mPendingMessageIndex = 1;
+        return false;//Wait for the data bytes
+    }
+
+    if (_mPendingMessageIndex == 0)//Data byte without pending message
+    {
+        if (_mRunningStatus_RX == InvalidType)
+        {
+            return false;//No running status: the byte is ignored
+        }
+        // Running status: the pending status, type and length are still
+        // the ones of the message that set the running status.
+        // The first data byte stands for the status byte arrival.
+        if (_mClock != nullptr)
+        {
+            _mPendingTime = _mClock();
+        }
+        _mPendingMessageIndex = 1;
+    }
+
+    // Add extracted data byte to pending message
+    if (_mPendingFlags & MIDI_STATUS_SYSEX)
+    {
+        if (_mSysExStream != nullptr)
+        {
+            streamSysExByte(extracted, false);
+            return false;
+        }
+        _mSysExArray[_mPendingMessageIndex] = extracted;//if system exclusive message data，store it in sysexArray
+
+        if (_mPendingMessageIndex >= _mMidiDatabytes)
+        {
+            // SysEx larger than the allocated buffer size,
+            // Split SysEx like so:
+            //   first:  0xF0 .... 0xF0
+            //   midlle: 0xF7 .... 0xF0
+            //   last:   0xF7 .... 0xF7
+            _mSysExCarry = _mSysExArray[SYS_EX_MAXSIZE - 1];
+            _mSysExArray[SYS_EX_MAXSIZE - 1] = SystemExclusiveStart;
+            _mParsed.type = SystemExclusive;
+
+            // Get length
+            _mParsed.data1   = SYS_EX_MAXSIZE & 0xff; // LSB
+            _mParsed.data2   = uint8_t(SYS_EX_MAXSIZE >> 8); // MSB
+            _mParsed.channel = 0;
+            _mParsedTime = _mPendingTime;
+
+            // No need to check against the inputChannel,
+            // SysEx ignores input channel.
+            // The buffer is re-seeded with the next byte, so that
+            // this chunk can be read before
+            _mSysExSplit = true;
+
+            return true;
+        }
+        _mPendingMessageIndex++;
+        return false;
+    }
+
+    _mPendingMessage[_mPendingMessageIndex] = extracted;//Otherwise, it is stored in the normal MIDI message processing array
+
+    // Now we are going to check if we have reached the end of the message
+    if (_mPendingMessageIndex < _mMidiDatabytes)
+    {
+        _mPendingMessageIndex++;//Waiting to receive a complete MIDI message
+        return false;//Wait for the next byte
+    }
+
+    _mParsed.type = _mPendingType;
+    //system common message are not assigned to any particular MIDI channel
+    _mParsed.channel = (_mPendingFlags & MIDI_STATUS_CHANNEL) ? getChannelFromStatusByte(_mPendingMessage[0]) : 0;
+    _mParsed.data1 = _mPendingMessage[1];
+    // Save data2 only if applicable
+    _mParsed.data2 = _mMidiDatabytes == 2 ? _mPendingMessage[2] : 0;
+    _mParsedTime = _mPendingTime;
+
+    _mPendingMessageIndex = 0;
+
+    // Activate running status (if enabled for the received type)
+    _mRunningStatus_RX = (_mPendingFlags & MIDI_STATUS_RUNNING) ? _mPendingMessage[0] : uint8_t(InvalidType);
+    return true;
+}
+/************************************************************************* 
+Description:    Enable or disable the streaming SysEx receive mode.
+                The SysEx bytes are stored in the user buffer, the chunk callback is
+                launched each time the buffer is full and at the end of the SysEx,
+                so SysEx of any length can be received without copy.
+parameter:
+    Input:      buffer：the user buffer, nullptr to go back to the SYS_EX_MAXSIZE buffer
+                size：the size of the buffer(2 bytes at least)
+                fptr：chunk callback(array, size, MIDI_SYSEX_START/MIDI_SYSEX_END flags)
+    Output:         
+Return:         
+Others:         The chunk callback is launched by the parser, so from serviceInput()
+                in interrupt mode. The buffer is reused after the callback returns.
+                The SysEx message(getSysEx(), SysEx callback) holds the last chunk.
+                A recorder(setRecorder()) records every chunk, except in interrupt
+                mode where only the SysEx that fit in one chunk are recorded.
+**************************************************************************/
+void MidiInterfaceCore::setSysExStream(uint8_t *buffer, uint16_t size, SysExChunkCallback fptr)
+{
+    resetInput();
+    if (buffer != nullptr && size >= 2)
+    {
+        _mSysExStream = buffer;
+        _mSysExCapacity = size;
+        _mSysExBuffer = buffer;
+        mSysExChunkCallback = fptr;
+    }
+    else
+    {
+        _mSysExStream = nullptr;
+        _mSysExBuffer = _mSysExArray;
+        mSysExChunkCallback = nullptr;
+    }
+}
+/************************************************************************* 
+Description:    Store one SysEx byte in the stream buffer and launch the chunk callback
+                when the buffer is full or at the end of the SysEx
+parameter:
+    Input:      data：the SysEx byte(0xF0 and 0xF7 included)
+                last：true：data ends the SysEx
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::streamSysExByte(uint8_t data, bool last)
+{
+    if (_mSysExLength >= _mSysExCapacity)//Full: deliver the chunk and reuse the buffer
+    {
+        if (mSysExChunkCallback != nullptr)
+        {
+            mSysExChunkCallback(_mSysExStream, _mSysExLength, _mSysExFirst ? MIDI_SYSEX_START : 0);
+        }
+        if (_mRecorder != nullptr && !_mInterruptMode)
+        {
+            //Recorded in order with the messages launched by the same call(not from serviceInput())
+            _mRecorder->recordSysEx(_mSysExStream, _mSysExLength, _mSysExFirst ? MIDI_SYSEX_START : 0,
+                                    (_mClock == micros) ? _mPendingTime : uint32_t(micros()));
+        }
+        _mSysExFirst = false;
+        _mSysExLength = 0;
+    }
+    _mSysExStream[_mSysExLength++] = data;
+
+    if (last)
+    {
+        if (mSysExChunkCallback != nullptr)
+        {
+            mSysExChunkCallback(_mSysExStream, _mSysExLength, (_mSysExFirst ? MIDI_SYSEX_START : 0) | MIDI_SYSEX_END);
+        }
+        _mParsed.type    = SystemExclusive;
+        _mParsed.data1   = _mSysExLength & 0xff; // LSB
+        _mParsed.data2   = uint8_t(_mSysExLength >> 8);   // MSB
+        _mParsed.channel = 0;
+        _mParsedTime = _mPendingTime;
+    }
+}
+/************************************************************************* 
+Description:    Parse one received byte and launch the callbacks of the completed message
+parameter:
+    Input:      extracted：the byte read from the transport
+    Output:         
+Return:         1: if a valid MIDI message on the input channel is completed
+                0: false if not.
+Others:         
+**************************************************************************/
+bool MidiInterfaceCore::receiveByte(uint8_t extracted)
+{
+    if (mByteHandler != nullptr)
+    {
+        mByteHandler(mByteContext, extracted);
+    }
+    if (_mThruOutput != nullptr)
+    {
+        thruByte(extracted);
+    }
+    if (!parseByte(extracted))
+    {
+        return false;
+    }
+    loadMessage(_mParsed, _mParsedTime);//The channel and type masks are applied by the parser
+    launchCallback();
+    return true;
+}
+/************************************************************************* 
+Description:    Parse one byte in drain mode: launch the callbacks
+                and queue each completed message
+parameter:
+    Input:      extracted：the byte read from the transport
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::drainByte(uint8_t extracted)
+{
+    if (mByteHandler != nullptr)
+    {
+        mByteHandler(mByteContext, extracted);
+    }
+    if (_mThruOutput != nullptr)
+    {
+        thruByte(extracted);
+    }
+    if (parseByte(extracted))
+    {
+        loadMessage(_mParsed, _mParsedTime);
+        launchCallback();
+        queueParsed();//Not full: drainInput() stops before
+    }
+}
+/************************************************************************* 
+Description:    Parse one byte in interrupt mode: queue each completed message(producer side)
+parameter:
+    Input:      extracted：the byte read from the transport
+    Output:         
+Return:         
+Others:         No callback is launched here
+**************************************************************************/
+void MidiInterfaceCore::serviceByte(uint8_t extracted)
+{
+    if (mByteHandler != nullptr)
+    {
+        mByteHandler(mByteContext, extracted);
+    }
+    if (_mThruOutput != nullptr)
+    {
+        thruByte(extracted);
+    }
+    if (parseByte(extracted))
+    {
+        queueParsed();//Counted as overflow if the ring is full
+    }
+}
+/************************************************************************* 
+Description:    Queue the message completed by the parser(producer side)
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         A queued SysEx has its size only: the SysEx buffer is kept busy
+                until the consumer has read it, no other SysEx is stored meanwhile
+**************************************************************************/
+void MidiInterfaceCore::queueParsed(void)
+{
+    const bool sysEx = (_mParsed.type == SystemExclusive);
+    if (sysEx)
+    {
+        _mSysExBusy = true;//Before the message is visible to the consumer
+    }
+    if (!_mRxQueue.push(_mParsed, _mRxTimes, _mParsedTime) && sysEx)
+    {
+        _mSysExBusy = false;
+    }
+}
+/************************************************************************* 
+Description:    Empty the receive queue and release the SysEx buffer
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Consumer side: the messages are popped, not cleared, so an interrupt
+                producer still running does not corrupt the ring
+**************************************************************************/
+void MidiInterfaceCore::resetQueue(void)
+{
+    MidiPacket message;
+    while (_mRxQueue.pop(message))
+    {
+    }
+    _mSysExPopped = true;
+    releaseSysEx();
+}
+/************************************************************************* 
+Description:    Release the SysEx buffer once the queued SysEx popped last has been read
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Consumer side, called before the next pop or drain
+**************************************************************************/
+void MidiInterfaceCore::releaseSysEx(void)
+{
+    if (_mSysExPopped)
+    {
+        _mSysExPopped = false;
+        __atomic_store_n(&_mSysExBusy, false, __ATOMIC_RELEASE);
+    }
+}
+/************************************************************************* 
+Description:    Tell whether the drain can parse one more byte
+parameter:
+    Input:          
+    Output:         
+Return:         true：a message completed by the next byte can be queued
+                false：the queue is full or a queued SysEx holds the SysEx buffer
+Others:         The bytes not drained stay in the serial port buffer
+**************************************************************************/
+bool MidiInterfaceCore::canDrain(void)
+{
+    return _mRxQueue.count() < MIDI_RX_QUEUE_SIZE - 1 && !_mSysExBusy;
+}
+/************************************************************************* 
+Description:    Pop a message queued in interrupt mode and launch its callbacks(consumer side)
+parameter:
+    Input:          
+    Output:         
+Return:         false：No message waiting
+                true：A message has been read
+Others:         
+**************************************************************************/
+bool MidiInterfaceCore::dispatchQueuedMessage(void)
+{
+    if (!popQueuedMessage())
+    {
+        return false;
+    }
+    launchCallback();
+    return true;
+}
+/************************************************************************* 
+Description:    Move the oldest queued message to the message structure
+parameter:
+    Input:          
+    Output:         
+Return:         false：The queue is empty
+                true：A message has been popped
+Others:         SysEx payload stays in the SysEx buffer until the next call
+**************************************************************************/
+bool MidiInterfaceCore::popQueuedMessage(void)
+{
+    MidiPacket message;
+    uint32_t time;
+    if (!popLatest(message, time))
+    {
+        return false;
+    }
+    loadMessage(message, time);
+    return true;
+}
+/************************************************************************* 
+Description:    Pop the oldest queued message; with input coalescing, a Control
+                Change, Pitch Bend or AfterTouch is skipped when a newer value
+                of the same(channel, controller) is queued behind it
+parameter:
+    Input:          
+    Output:     message：the compact message
+                time：its arrival time
+Return:         false：No message waiting
+                true：A message has been popped
+Others:         The kept value is delivered at its own place, the other
+                messages keep their order. The look-ahead stops at a note or a
+                Program Change on the same channel
+**************************************************************************/
+bool MidiInterfaceCore::popLatest(MidiPacket &message, uint32_t &time)
+{
+    releaseSysEx();//The SysEx popped by the previous call has been read
+    while (_mRxQueue.pop(message, _mRxTimes, time))
+    {
+        _mSysExPopped = (message.type == SystemExclusive);
+        const bool keyed = (message.type == ControlChange || message.type == AfterTouchPoly);//one value per controller or note
+        if (!_mCoalesce
+        ||  !(keyed || message.type == PitchBend || message.type == AfterTouchChannel)
+        ||  (message.type == ControlChange && (!MidiControllerCache::isCached(message.data1)
+                                               || (message.data1 >= Sustain && message.data1 <= Hold))))
+        {
+            return true;//The switches(pedals) are states, each change is delivered
         }
-        if (_mPendingMessageIndex >= _mMidiDatabytes)
+        MidiPacket newer;
+        bool outdated = false;
+        for (uint8_t i = 0; !outdated && _mRxQueue.peek(i, newer); i++)
         {
-                // Reception complete
-            _midiMessage.type    = pendingType;
-            _midiMessage.channel = getChannelFromStatusByte(_mPendingMessage[0]);
-            _midiMessage.data1   = _mPendingMessage[1];
-            _midiMessage.data2   = 0; // Completed new message has 1 data byte
-            //  _midiMessage.length  = 1;
-
-            _mPendingMessageIndex = 0;
-            _mMidiDatabytes = 0;
-            _midiMessage.valid = true;
-
-            return true;     
+            if (newer.channel == message.channel
+            &&  (newer.type == NoteOn || newer.type == NoteOff || newer.type == ProgramChange))
+            {
+                break;//The value applies to this note or program: it is delivered before
+            }
+            outdated = (newer.type == message.type && newer.channel == message.channel
+                    && (!keyed || newer.data1 == message.data1));
         }
-        else
+        if (!outdated)
         {
-            // Waiting for more data
-            _mPendingMessageIndex++;
+            return true;
         }
-        return (MidiMessage::Use1ByteParsing) ? false : parse();//Continue receiving bytes for parsing
+        _mCoalesced++;
     }
-    else//There were already messages waiting to be processed
+    return false;
+}
+/************************************************************************* 
+Description:    Copy a parsed message to the message structure read by the getters
+parameter:
+    Input:      message：the compact message
+                time：its arrival time(see setTimestamp)
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::loadMessage(const MidiPacket &message, uint32_t time)
+{
+    _midiMessage.type    = message.type;
+    _midiMessage.channel = message.channel;
+    _midiMessage.data1   = message.data1;
+    _midiMessage.data2   = message.data2;
+    setSysExArray();
+    _mMessageTime = time;
+    _midiMessage.valid   = true;
+}
+/************************************************************************* 
+Description:    Point the deprecated MidiMessage::sysexArray to the SysEx payload
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Kept for the sketches written when the payload was in MidiMessage
+**************************************************************************/
+void MidiInterfaceCore::setSysExArray(void)
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    _midiMessage.sysexArray = _mSysExBuffer;
+#pragma GCC diagnostic pop
+}
+/************************************************************************* 
+Description:    Enable or disable the soft MIDI Thru: each received byte is
+                forwarded to the output as soon as it is read, without decoding
+                and re-encoding the message.
+parameter:
+    Input:      output：the interface to forward to(this one for the same port),
+                        nullptr：thru off(default)
+    Output:         
+Return:         
+Others:         Running status and interleaved real-time bytes are forwarded as
+                received. A message sent by the output in the middle of a forwarded
+                message ends it: the status byte is sent again for the next one.
+                In interrupt mode the bytes are forwarded from serviceInput().
+**************************************************************************/
+void MidiInterfaceCore::setThru(MidiInterfaceCore *output)
+{
+    _mThruOutput = output;
+    _mThruStatus = 0;
+    _mThruIndex = 0;
+    if (output != nullptr)
     {
-        if (extracted >= 0x80)//Determine if it is a new status byte message
-        {
-            // Reception of status bytes in the middle of an uncompleted message
-            // are allowed only for interleaved Real Time message or EOX
-            switch (extracted)
-            {
-                case Clock:
-                case Start:
-                case Continue:
-                case Stop:
-                case ActiveSensing:
-                case SystemReset:
-
-                    // Here we will have to extract the one-byte message,
-                    // pass it to the structure for being read outside
-                    // the MIDI class, and recompose the message it was
-                    // interleaved into. Oh, and without killing the running status..
-                    // This is done by leaving the pending message as is,
-                    // it will be completed on next calls.
-                    _midiMessage.type    = (MidiType)extracted;
-                    _midiMessage.data1   = 0;
-                    _midiMessage.data2   = 0;
-                    _midiMessage.channel = 0;
-                    _midiMessage.valid   = true;
-
-                    return true;
-
-                    // Exclusive
-                case SystemExclusiveStart:
-                case SystemExclusiveEnd:
-                    if ((_midiMessage.sysexArray[0] == SystemExclusiveStart)
-                    ||  (_midiMessage.sysexArray[0] == SystemExclusiveEnd))
-                    {
-                        // Store the last byte (EOX:F7)sysexArray{f0 xx xx f7}
-                        _midiMessage.sysexArray[_mPendingMessageIndex++] = extracted;
-                        _midiMessage.type = SystemExclusive;
-
-                        // Get length
-                        _midiMessage.data1   = _mPendingMessageIndex & 0xff; // LSB
-                        _midiMessage.data2   = uint8_t(_mPendingMessageIndex >> 8);   // MSB
-                        _midiMessage.channel = 0;
-                        _midiMessage.valid   = true;
-
-                        resetInput();
+        output->_mThruWire = 0;
+    }
+}
+/************************************************************************* 
+Description:    Select the channels forwarded by the soft thru
+parameter:
+    Input:      mask：bit 0 for channel 1 ... bit 15 for channel 16,
+                      MIDI_CHANNEL_MASK_ALL：all the channels(default)
+    Output:         
+Return:         
+Others:         Independent of the input channel mask
+**************************************************************************/
+void MidiInterfaceCore::setThruChannelMask(uint16_t mask)
+{
+    _mThruChannelMask = mask;
+    _mThruStatus = 0;
+}
+/************************************************************************* 
+Description:    Select the message types forwarded by the soft thru
+parameter:
+    Input:      mask：MIDI_TYPE_BIT(type) of each forwarded type,
+                      MIDI_TYPE_MASK_ALL：all the types(default)
+    Output:         
+Return:         
+Others:         Independent of the input type mask
+**************************************************************************/
+void MidiInterfaceCore::setThruTypeMask(uint32_t mask)
+{
+    _mThruTypeMask = mask;
+    _mThruStatus = 0;
+}
+/************************************************************************* 
+Description:    Get the number of bytes forwarded by the soft thru
+parameter:
+    Input:          
+    Output:         
+Return:         the number of bytes written to the output(status bytes sent again included)
+Others:         
+**************************************************************************/
+uint32_t MidiInterfaceCore::getThruByteCount(void)
+{
+    return _mThruBytes;
+}
+/************************************************************************* 
+Description:    Forward one received byte to the thru output
+parameter:
+    Input:      extracted：the byte read from the transport
+    Output:         
+Return:         
+Others:         The filters are checked once on the status byte, the data bytes
+                follow the decision. _mThruWire of the output tells whether the
+                wire status is still the one of the forwarded message.
+**************************************************************************/
+void MidiInterfaceCore::thruByte(uint8_t extracted)
+{
+    MidiInterfaceCore *output = _mThruOutput;
 
-                        return true;
-                    }
-                    else
-                    {
-                        resetInput();
-                        return false;
-                    }
+    if (extracted >= 0x80)
+    {
+        const uint16_t entry = pgm_read_word(&sMidiStatusTable[extracted]);
+        const MidiType statusType = MidiType(entry & 0xff);
+        const uint8_t statusFlags = uint8_t(entry >> 8);
+        const bool pass = (statusType != InvalidType) && (_mThruTypeMask & (1UL << midiTypeIndex(extracted)))
+                       && (!(statusFlags & MIDI_STATUS_CHANNEL) || (_mThruChannelMask & (1U << (extracted & 0x0f))));
 
-                default:
-                    break; // LCOV_EXCL_LINE - Coverage blind spot
-            }
-            
-        }
-        // Add extracted data byte to pending message
-        if ((_mPendingMessage[0] == SystemExclusiveStart)
-        ||  (_mPendingMessage[0] == SystemExclusiveEnd))
-        {
-            _midiMessage.sysexArray[_mPendingMessageIndex] = extracted;//if system exclusive message data，store it in sysexArray
-        } 
-        else
+        if (statusFlags & MIDI_STATUS_REALTIME)
         {
-            _mPendingMessage[_mPendingMessageIndex] = extracted;//Otherwise, it is stored in the normal MIDI message processing array
+            if (pass)
+            {
+                output->sendRealTime(statusType);//Interleaved as received
+                _mThruBytes++;
+            }
+            return;
         }
-            
-        // Now we are going to check if we have reached the end of the message
-        if (_mPendingMessageIndex >= _mMidiDatabytes)
+        if (extracted == SystemExclusiveEnd)
         {
-            // SysEx larger than the allocated buffer size,
-            // Split SysEx like so:
-            //   first:  0xF0 .... 0xF0
-            //   midlle: 0xF7 .... 0xF0
-            //   last:   0xF7 .... 0xF7
-            if ((_mPendingMessage[0] == SystemExclusiveStart)
-            ||  (_mPendingMessage[0] == SystemExclusiveEnd))
+            if (_mThruStatus == SystemExclusiveStart && _mThruPass && output->_mThruWire == SystemExclusiveStart)
             {
-                auto lastByte = _midiMessage.sysexArray[SYS_EX_MAXSIZE - 1];
-                _midiMessage.sysexArray[SYS_EX_MAXSIZE - 1] = SystemExclusiveStart;
-                _midiMessage.type = SystemExclusive;
-
-                // Get length
-                _midiMessage.data1   = SYS_EX_MAXSIZE & 0xff; // LSB
-                _midiMessage.data2   = uint8_t(SYS_EX_MAXSIZE >> 8); // MSB
-                _midiMessage.channel = 0;
-                _midiMessage.valid   = true;
-
-                // No need to check against the inputChannel,
-                // SysEx ignores input channel
-                launchCallback();
-
-                _midiMessage.sysexArray[0] = SystemExclusiveEnd;
-                _midiMessage.sysexArray[1] = lastByte;
-
-                _mPendingMessageIndex = 2;
-
-                return false;
+                output->thruWrite(extracted);
+                _mThruBytes++;
             }
+            output->_mThruWire = (output->_mThruWire == SystemExclusiveStart) ? 0 : output->_mThruWire;
+            _mThruStatus = 0;
+            return;
+        }
 
-            _midiMessage.type = getTypeFromStatusByte(_mPendingMessage[0]);
-
-            if (isChannelMessage(_midiMessage.type))
-            {
-                _midiMessage.channel = getChannelFromStatusByte(_mPendingMessage[0]);
-            }   
-            else
+        _mThruStatus = (statusType != InvalidType) ? extracted : 0;
+        _mThruLength = statusFlags & MIDI_STATUS_LENGTH;
+        _mThruIndex = 0;
+        _mThruPass = pass;
+        if (pass)
+        {
+            output->thruWrite(extracted);//The status byte goes out at once
+            output->_mThruWire = (_mThruLength != 0 || extracted == SystemExclusiveStart) ? extracted : 0;
+            _mThruBytes++;
+            if (output->_mThruWire == 0)
             {
-                _midiMessage.channel = 0;//system exclusive message are not assigned to any particular MIDI channel
+                _mThruStatus = 0;//Tune Request: complete
             }
-                
-            _midiMessage.data1 = _mPendingMessage[1];
-            // Save data2 only if applicable
-            _midiMessage.data2 = _mMidiDatabytes == 2 ? _mPendingMessage[2] : 0;
-
-            // Reset local variables
-            _mPendingMessageIndex = 0;
-            _mMidiDatabytes = 0;
-
-            _midiMessage.valid = true;
-
-            // Activate running status (if enabled for the received type)
-            switch (_midiMessage.type)
-            {
-                case NoteOff:
-                case NoteOn:
-                case AfterTouchPoly:
-                case ControlChange:
-                case ProgramChange:
-                case AfterTouchChannel:
-                case PitchBend:
-                    // Running status enabled: store it from received message
-                    _mRunningStatus_RX = _mPendingMessage[0];
-                    break;
+        }
+        return;
+    }
 
-                default:
-                    // No running status
-                    _mRunningStatus_RX = InvalidType;
-                    break;
-            }
-            return true;
+    if (_mThruStatus == 0 || !_mThruPass)
+    {
+        return;//No status or filtered out
+    }
+    if (_mThruStatus == SystemExclusiveStart)
+    {
+        if (output->_mThruWire == SystemExclusiveStart)
+        {
+            output->thruWrite(extracted);
+            _mThruBytes++;
         }
-        else
+        return;//An interrupted SysEx is not resumed
+    }
+
+    if (_mThruIndex == _mThruLength)
+    {
+        _mThruIndex = 0;//Running status: a new message starts
+    }
+    if (output->_mThruWire != _mThruStatus)
+    {
+        if (_mThruIndex != 0)
         {
-            _mPendingMessageIndex++;//Waiting to receive a complete MIDI message
-            return (MidiMessage::Use1ByteParsing) ? false : parse();//Continue receiving bytes for parsing
+            _mThruIndex++;//Interrupted by the output: the rest of the message is dropped
+            return;
         }
+        output->thruWrite(_mThruStatus);//Restore the status before the next message
+        output->_mThruWire = _mThruStatus;
+        _mThruBytes++;
+    }
+    output->thruWrite(extracted);
+    _mThruBytes++;
+
+    if (++_mThruIndex == _mThruLength && _mThruStatus >= SystemExclusiveStart)
+    {
+        _mThruStatus = 0;//System Common messages have no running status
+        output->_mThruWire = 0;
+    }
+}
+/************************************************************************* 
+Description:    Write a byte forwarded by a soft thru(output side)
+parameter:
+    Input:      data：the byte
+    Output:         
+Return:         
+Others:         The transmit running status is cancelled: the wire status
+                is now the one of the forwarded stream
+**************************************************************************/
+void MidiInterfaceCore::thruWrite(uint8_t data)
+{
+    if (data >= 0x80)
+    {
+        _mRunningStatus_TX = InvalidType;
+    }
+    txByte(data);
+    endTransmission();
+}
+/************************************************************************* 
+Description:    Enable or disable the message timestamps.
+                Each message is stamped when its status byte arrives(its first
+                data byte with running status), and the delay until its
+                callbacks are launched is measured.
+parameter:
+    Input:      enable：true：stamp the messages；false：timestamp 0(default)
+                clock：the time base, micros() by default(any counter for host tests)
+    Output:         
+Return:         
+Others:         The clock is read in the parsing context(serviceInput() in interrupt mode).
+                The messages queued by the drain or interrupt mode keep their
+                arrival time in a ring parallel to the receive ring.
+**************************************************************************/
+void MidiInterfaceCore::setTimestamp(bool enable, MidiClockFunction clock)
+{
+    _mClock = enable ? clock : nullptr;
+    _mPendingTime = 0;
+    resetDispatchDelay();
+    updateHooks();
+}
+/************************************************************************* 
+Description:    Get the arrival time of the last received message
+parameter:
+    Input:          
+    Output:         
+Return:         the clock value when its status byte arrived, 0 if timestamps are disabled
+Others:         
+**************************************************************************/
+uint32_t MidiInterfaceCore::getMessageTimestamp(void)
+{
+    return _mMessageTime;
+}
+/************************************************************************* 
+Description:    Get the receive-to-dispatch delay statistics
+parameter:
+    Input:          
+    Output:         
+Return:         minimum, maximum and mean delay between the arrival of a message
+                and the launch of its callbacks, in clock units
+Others:         
+**************************************************************************/
+MidiDelayStats MidiInterfaceCore::getDispatchDelay(void)
+{
+    MidiDelayStats stats;
+    stats.minimum = (_mDelayCount != 0) ? _mDelayMin : 0;
+    stats.maximum = _mDelayMax;
+    stats.mean    = (_mDelaySamples != 0) ? _mDelaySum / _mDelaySamples : 0;
+    stats.count   = _mDelayCount;
+    return stats;
+}
+/************************************************************************* 
+Description:    Clear the receive-to-dispatch delay statistics
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::resetDispatchDelay(void)
+{
+    _mDelayMin = 0xffffffff;
+    _mDelayMax = 0;
+    _mDelaySum = 0;
+    _mDelaySamples = 0;
+    _mDelayCount = 0;
+}
+/************************************************************************* 
+Description:    Add the delay of the message being dispatched to the statistics
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::measureDispatchDelay(void)
+{
+    const uint32_t delay = uint32_t(_mClock()) - _mMessageTime;
+    if (delay < _mDelayMin)
+    {
+        _mDelayMin = delay;
     }
-    
+    if (delay > _mDelayMax)
+    {
+        _mDelayMax = delay;
+    }
+    if (_mDelaySum + delay < _mDelaySum)//Keep the mean without overflow
+    {
+        _mDelaySum /= 2;
+        _mDelaySamples /= 2;
+    }
+    _mDelaySum += delay;
+    _mDelaySamples++;
+    _mDelayCount++;
 }
 /************************************************************************* 
 Description:    check if the received message is on the listened channel
@@ -939,16 +2419,30 @@ parameter:
 Return:         
 Others:         
 **************************************************************************/
-bool BMV51M001::inputFilter(uint8_t channel)
+bool MidiInterfaceCore::inputFilter(uint8_t channel)
+{
+  return isListened(_midiMessage.type, _midiMessage.channel, channel);
+}
+/************************************************************************* 
+Description:    check if a message is on the given channel
+parameter:
+    Input:      type：the message type
+                messageChannel：the message channel
+                channel：The listened channel (1 to 16) or MIDI_CHANNEL_OMNI.
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+bool MidiInterfaceCore::isListened(MidiType type, uint8_t messageChannel, uint8_t channel)
 {
   // This method handles recognition of channel
   // (to know if the message is destinated to the Arduino)
 
   // First, check if the received message is Channel
-  if (_midiMessage.type >= NoteOff && _midiMessage.type <= PitchBend)
+  if (type >= NoteOff && type <= PitchBend)
   {
     // Then we need to know if we listen to it
-    if ((_midiMessage.channel == channel) ||
+    if ((messageChannel == channel) ||
         (channel == MIDI_CHANNEL_OMNI))
     {
         return true;
@@ -973,7 +2467,7 @@ Description:    reset input attributes
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::resetInput(void)
+void MidiInterfaceCore::resetInput(void)
 {
   _mMidiDatabytes = 0;
   _mPendingMessageIndex = 0;
@@ -989,7 +2483,7 @@ parameter:
 Return:         Returns an enumerated type
 Others:         
 **************************************************************************/
-MidiType BMV51M001::getMessageType(void) 
+MidiType MidiInterfaceCore::getMessageType(void) 
 {
   return _midiMessage.type;
 }
@@ -1002,7 +2496,7 @@ Return:         Channel range is 1 to 16.
                 For non-channel messages, this will return 0.
 Others:         
 **************************************************************************/
-uint8_t BMV51M001::getMessageChannel(void)
+uint8_t MidiInterfaceCore::getMessageChannel(void)
 {
   return _midiMessage.channel;
 }
@@ -1014,7 +2508,7 @@ parameter:
 Return:         return MIDI Message's data1
 Others:         
 **************************************************************************/
-uint8_t BMV51M001::getMessageData1(void)
+uint8_t MidiInterfaceCore::getMessageData1(void)
 {
   return _midiMessage.data1;
 }
@@ -1026,7 +2520,7 @@ parameter:
 Return:         return MIDI Message's data2
 Others:         
 **************************************************************************/
-uint8_t BMV51M001::getMessageData2(void)
+uint8_t MidiInterfaceCore::getMessageData2(void)
 {
   return _midiMessage.data2;
 }
@@ -1038,12 +2532,27 @@ parameter:
 Return:         
 Others:         
 **************************************************************************/
-uint8_t BMV51M001::getSysExArray(uint8_t dataBuffer[]) 
+uint8_t MidiInterfaceCore::getSysExArray(uint8_t dataBuffer[]) 
 {
-    memcpy( dataBuffer,_midiMessage.sysexArray,_midiMessage.getSysExSize());
+    memcpy( dataBuffer,_mSysExBuffer,_midiMessage.getSysExSize());
     return _midiMessage.getSysExSize();
 }
 
+/************************************************************************* 
+Description:    Get a handle on the System Exclusive payload(no copy).
+parameter:
+    Input:          
+    Output:         
+Return:         return the SysEx buffer and the size of the last received SysEx
+Others:         The buffer is overwritten by the next SysEx
+**************************************************************************/
+MidiSysEx MidiInterfaceCore::getSysEx(void)
+{
+    MidiSysEx sysex;
+    sysex.array = _mSysExBuffer;
+    sysex.size  = uint16_t(_midiMessage.data2 << 8 | _midiMessage.data1);
+    return sysex;
+}
 /************************************************************************* 
 Description:    Check if a valid message is stored in the structure
 parameter:
@@ -1053,7 +2562,7 @@ Return:         return false：invalid message
                        true：valid message
 Others:         
 **************************************************************************/
-bool BMV51M001::checkMessageValid(void) 
+bool MidiInterfaceCore::checkMessageValid(void) 
 {
   bool result =   _midiMessage.valid;
   _midiMessage.valid=false;
@@ -1067,7 +2576,7 @@ parameter:
 Return:         return MIDI Input Channel
 Others:         
 **************************************************************************/
-uint8_t BMV51M001::getInputChannel(void)
+uint8_t MidiInterfaceCore::getInputChannel(void)
 {
   return _mInputChannel;
 }
@@ -1080,9 +2589,133 @@ parameter:
 Return:         return MIDI Input Channel
 Others:         
 **************************************************************************/
-void BMV51M001::setInputChannel(uint8_t inputChannel)
+void MidiInterfaceCore::setInputChannel(uint8_t inputChannel)
 {
   _mInputChannel = inputChannel;
+  if (inputChannel == MIDI_CHANNEL_OMNI)
+  {
+    _mChannelMask = MIDI_CHANNEL_MASK_ALL;
+  }
+  else if (inputChannel < MIDI_CHANNEL_OFF)
+  {
+    _mChannelMask = 1U << (inputChannel - 1);
+  }
+}
+/************************************************************************* 
+Description:    Listen to several channels
+parameter:
+    Input:      mask：bit 0 for channel 1 ... bit 15 for channel 16,
+                      MIDI_CHANNEL_MASK_ALL：all the channels
+    Output:         
+Return:         
+Others:         Checked by the parser on the status byte: the channel messages
+                of the other channels are not stored and launch no callback.
+                setInputChannel() replaces the mask.
+**************************************************************************/
+void MidiInterfaceCore::setChannelMask(uint16_t mask)
+{
+  _mChannelMask = mask;
+  resetInput();
+}
+/************************************************************************* 
+Description:    Get the listened channels
+parameter:
+    Input:          
+    Output:         
+Return:         the channel mask(bit 0 for channel 1)
+Others:         
+**************************************************************************/
+uint16_t MidiInterfaceCore::getChannelMask(void)
+{
+  return _mChannelMask;
+}
+/************************************************************************* 
+Description:    Decode the received RPN, NRPN and 14-bit controller sequences:
+                the callbacks of setHandleRpn(), setHandleNrpn() and
+                setHandleControlChange14() get the parameter number and 14-bit value
+parameter:
+    Input:      decoder：the decoder(per channel state), nullptr：off(default)
+    Output:         
+Return:         
+Others:         The Control Change callback still gets every raw message. An MSB
+                and its LSB give one event, launched with the LSB, or for a sender
+                of the MSB only with the next message or by isMIDIMessageOK() when
+                nothing is received for MIDI_PARAMETER_TIMEOUT.
+**************************************************************************/
+void MidiInterfaceCore::setParameterDecoder(MidiParameterDecoder *decoder)
+{
+    _mParameterDecoder = decoder;
+    if (decoder != nullptr)
+    {
+        decoder->reset();
+    }
+    updateHooks();
+}
+/************************************************************************* 
+Description:    Record the received messages into a MIDI file
+parameter:
+    Input:      recorder：the recorder(started with its begin()), nullptr：off(default)
+    Output:         
+Return:         
+Others:         The messages are recorded before their callbacks, only those
+                accepted by the input channel and type filters. With setTimestamp()
+                on micros() the events are timed from the arrival of their status byte.
+**************************************************************************/
+void MidiInterfaceCore::setRecorder(MidiFileRecorder *recorder)
+{
+    _mRecorder = recorder;
+    updateHooks();
+}
+/************************************************************************* 
+Description:    Select the received message types
+parameter:
+    Input:      mask：MIDI_TYPE_BIT(type) of each accepted type,
+                      MIDI_TYPE_MASK_ALL：all the types(default)
+    Output:         
+Return:         
+Others:         Checked by the parser on the status byte: the other types
+                are not stored and launch no callback
+**************************************************************************/
+void MidiInterfaceCore::setTypeMask(uint32_t mask)
+{
+  _mTypeMask = mask;
+  resetInput();
+}
+/************************************************************************* 
+Description:    Get the received message types
+parameter:
+    Input:          
+    Output:         
+Return:         the type mask(MIDI_TYPE_BIT(type) of each accepted type)
+Others:         
+**************************************************************************/
+uint32_t MidiInterfaceCore::getTypeMask(void)
+{
+  return _mTypeMask;
+}
+/************************************************************************* 
+Description:    Accept or reject one message type
+parameter:
+    Input:      type：the message type
+                accept：true：receive it；false：ignore it
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::setTypeFilter(MidiType type, bool accept)
+{
+  if (type == InvalidType)
+  {
+    return;
+  }
+  if (accept)
+  {
+    setTypeMask(_mTypeMask | MIDI_TYPE_BIT(type));
+  }
+  else
+  {
+    setTypeMask(_mTypeMask & ~MIDI_TYPE_BIT(type));
+  }
 }
 /************************************************************************* 
 Description:    Check whether it is MIDI Channel Messages
@@ -1093,15 +2726,9 @@ Return:         return true：it is MIDI Channel Messages
                        false:：not MIDI Channel Messages
 Others:         
 **************************************************************************/
-bool BMV51M001::isChannelMessage(MidiType type)
+bool MidiInterfaceCore::isChannelMessage(MidiType type)
 {
-    return (type == NoteOff           ||
-            type == NoteOn            ||
-            type == ControlChange     ||
-            type == AfterTouchPoly    ||
-            type == AfterTouchChannel ||
-            type == PitchBend         ||
-            type == ProgramChange);
+    return (pgm_read_word(&sMidiStatusTable[type]) >> 8) & MIDI_STATUS_CHANNEL;
 }
 /************************************************************************* 
 Description:    Extract an enumerated MIDI type from a status byte.
@@ -1112,24 +2739,9 @@ Return:         return InvalidType：Invalid MidiType
                        or valid midi type byte
 Others:         
 **************************************************************************/
-MidiType BMV51M001::getTypeFromStatusByte(uint8_t status)
+MidiType MidiInterfaceCore::getTypeFromStatusByte(uint8_t status)
 {
-  if ((status  < 0x80) ||
-      (status == Undefined_F4) ||
-      (status == Undefined_F5) ||
-      (status == Undefined_FD))
-  {
-    return InvalidType; // Data bytes and undefined.        
-  }
-
-  if (status < 0xf0)
-  {
-      // Channel message, remove channel nibble.
-      return MidiType(status & 0xf0);
-  }
-
-  return MidiType(status);
-
+  return MidiType(pgm_read_word(&sMidiStatusTable[status]) & 0xff);// Data bytes and undefined: InvalidType
 }
 /************************************************************************* 
 Description:    get MIDI channel
@@ -1139,43 +2751,145 @@ parameter:
 Return:         Returns channel in the range 1-16
 Others:         
 **************************************************************************/
-uint8_t BMV51M001::getChannelFromStatusByte(uint8_t status)
+uint8_t MidiInterfaceCore::getChannelFromStatusByte(uint8_t status)
 {
   return uint8_t((status & 0x0f) + 1);
 }
 /************************************************************************* 
+Description:    Set the callback launched for every received message
+parameter:
+    Input:      fptr：the callback, nullptr to disconnect it
+    Output:         
+Return:         
+Others:         Launched before the callback of the message type
+**************************************************************************/
+void MidiInterfaceCore::setHandleMessage(void (*fptr)(const MidiMessage&))
+{
+    _mMessageEntry.callback.message = fptr;
+    _mMessageEntry.thunk = (fptr != nullptr) ? &launchMessage : nullptr;
+    updateHooks();
+}
+/************************************************************************* 
+Description:    Set the handler launched for every received message, with a context
+parameter:
+    Input:      handler：the handler, nullptr to disconnect it
+                context：passed back to the handler(the object handling the messages)
+    Output:         
+Return:         
+Others:         The context is shared with the setHandler() handlers: the last one set
+                is passed to all of them
+**************************************************************************/
+void MidiInterfaceCore::setHandleMessage(MidiHandler handler, void *context)
+{
+    _mMessageEntry.callback.handler = handler;
+    _mMessageEntry.thunk = (handler != nullptr) ? &launchHandler : nullptr;
+    _mHandlerContext = context;
+    updateHooks();
+}
+/************************************************************************* 
+Description:    Set the handler of a message type, with a context
+parameter:
+    Input:      type：the message type
+                handler：called with the context and the message, nullptr to disconnect it
+                context：passed back to the handler(the object handling the messages),
+                         so several interfaces can share the same handler code
+    Output:         
+Return:         
+Others:         Replaces the setHandleXxx() callback of the type.
+                The SysEx payload is read with getSysEx().
+                The context is kept once per interface(2 bytes instead of one
+                per type): the last one set is passed to all the handlers.
+**************************************************************************/
+void MidiInterfaceCore::setHandler(MidiType type, MidiHandler handler, void *context)
+{
+    if (type == InvalidType)
+    {
+        return;
+    }
+    MidiDispatchEntry &entry = _mDispatch[midiTypeIndex(type)];
+    entry.callback.handler = handler;
+    entry.thunk = (handler != nullptr) ? &launchHandler : nullptr;
+    _mHandlerContext = context;
+}
+/************************************************************************* 
+Description:    Set the handler called with every received byte, before it is parsed
+parameter:
+    Input:      handler：the handler, nullptr to disconnect it
+                context：passed back to the handler
+    Output:         
+Return:         
+Others:         Used by MidiMerger. Called from serviceInput() in interrupt mode.
+**************************************************************************/
+void MidiInterfaceCore::setHandleReceivedByte(MidiByteHandler handler, void *context)
+{
+    mByteHandler = handler;
+    mByteContext = context;
+}
+/************************************************************************* 
+Description:    Set the callback of a message type(one overload per callback signature)
+parameter:
+    Input:      type：the message type
+                fptr：the callback, nullptr to disconnect it
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::connectCallback(MidiType type, void (*fptr)(uint8_t, uint8_t, uint8_t))
+{
+    MidiDispatchEntry &entry = _mDispatch[midiTypeIndex(type)];
+    entry.callback.channelData = fptr;
+    entry.thunk = (fptr != nullptr) ? &launchChannelData : nullptr;
+}
+void MidiInterfaceCore::connectCallback(MidiType type, void (*fptr)(uint8_t, uint8_t))
+{
+    MidiDispatchEntry &entry = _mDispatch[midiTypeIndex(type)];
+    entry.callback.channelValue = fptr;
+    entry.thunk = (fptr != nullptr) ? &launchChannelValue : nullptr;
+}
+void MidiInterfaceCore::connectCallback(MidiType type, void (*fptr)(uint8_t, int16_t))
+{
+    MidiDispatchEntry &entry = _mDispatch[midiTypeIndex(type)];
+    entry.callback.pitchBend = fptr;
+    entry.thunk = (fptr != nullptr) ? &launchPitchBend : nullptr;
+}
+void MidiInterfaceCore::connectCallback(MidiType type, void (*fptr)(uint8_t *, uint16_t))
+{
+    MidiDispatchEntry &entry = _mDispatch[midiTypeIndex(type)];
+    entry.callback.systemExclusive = fptr;
+    entry.thunk = (fptr != nullptr) ? &launchSystemExclusive : nullptr;
+}
+void MidiInterfaceCore::connectCallback(MidiType type, void (*fptr)(uint8_t))
+{
+    MidiDispatchEntry &entry = _mDispatch[midiTypeIndex(type)];
+    entry.callback.systemData = fptr;
+    entry.thunk = (fptr != nullptr) ? &launchSystemData : nullptr;
+}
+void MidiInterfaceCore::connectCallback(MidiType type, void (*fptr)(uint16_t))
+{
+    MidiDispatchEntry &entry = _mDispatch[midiTypeIndex(type)];
+    entry.callback.songPosition = fptr;
+    entry.thunk = (fptr != nullptr) ? &launchSongPosition : nullptr;
+}
+void MidiInterfaceCore::connectCallback(MidiType type, void (*fptr)(void))
+{
+    MidiDispatchEntry &entry = _mDispatch[midiTypeIndex(type)];
+    entry.callback.realTime = fptr;
+    entry.thunk = (fptr != nullptr) ? &launchRealTime : nullptr;
+}
+/************************************************************************* 
 Description:    Detach an external function from the given type.
                 Use this method to cancel the effects of setHandle********.
 parameter:
-    Input:          
+    Input:      type：the message type
     Output:         
 Return:         
 Others:         
 **************************************************************************/
-void BMV51M001::disconnectCallbackFromType(MidiType type)
+void MidiInterfaceCore::disconnectCallbackFromType(MidiType type)
 {
-    switch (type)
+    if (type != InvalidType)
     {
-        case NoteOff:               mNoteOffCallback                = nullptr; break;
-        case NoteOn:                mNoteOnCallback                 = nullptr; break;
-        case AfterTouchPoly:        mAfterTouchPolyCallback         = nullptr; break;
-        case ControlChange:         mControlChangeCallback          = nullptr; break;
-        case ProgramChange:         mProgramChangeCallback          = nullptr; break;
-        case AfterTouchChannel:     mAfterTouchChannelCallback      = nullptr; break;
-        case PitchBend:             mPitchBendCallback              = nullptr; break;
-        case SystemExclusive:       mSystemExclusiveCallback        = nullptr; break;
-        case TimeCodeQuarterFrame:  mTimeCodeQuarterFrameCallback   = nullptr; break;
-        case SongPosition:          mSongPositionCallback           = nullptr; break;
-        case SongSelect:            mSongSelectCallback             = nullptr; break;
-        case TuneRequest:           mTuneRequestCallback            = nullptr; break;
-        case Clock:                 mClockCallback                  = nullptr; break;
-        case Start:                 mStartCallback                  = nullptr; break;
-        case Continue:              mContinueCallback               = nullptr; break;
-        case Stop:                  mStopCallback                   = nullptr; break;
-        case ActiveSensing:         mActiveSensingCallback          = nullptr; break;
-        case SystemReset:           mSystemResetCallback            = nullptr; break;
-        default:
-            break;
+        _mDispatch[midiTypeIndex(type)].thunk = nullptr;
     }
 }
 /************************************************************************* 
@@ -1184,48 +2898,213 @@ parameter:
     Input:          
     Output:         
 Return:         
-Others:         
+Others:         One flags test and one indexed call per message when no hook is
+                set: the table entry of the type holds the thunk matching the
+                callback signature
 **************************************************************************/
-void BMV51M001::launchCallback()
+void MidiInterfaceCore::launchCallback()
 {
-  if (mMessageCallback != 0) 
+  if (_mHooks != 0)
   {
-    mMessageCallback(_midiMessage);
+    launchHooks();
   }
-  // The order is mixed to allow frequent messages to trigger their callback faster.
-  switch (_midiMessage.type)
+  const MidiDispatchEntry &entry = _mDispatch[midiTypeIndex(_midiMessage.type)];
+  if (entry.thunk != nullptr)
   {
-        // Notes
-    case NoteOff:               if (mNoteOffCallback != nullptr)               mNoteOffCallback(_midiMessage.channel, _midiMessage.data1, _midiMessage.data2);   break;
-    case NoteOn:                if (mNoteOnCallback != nullptr)                mNoteOnCallback(_midiMessage.channel, _midiMessage.data1, _midiMessage.data2);    break;
-
-        // Real-time messages
-    case Clock:                 if (mClockCallback != nullptr)                 mClockCallback();           break;
-    case Start:                 if (mStartCallback != nullptr)                 mStartCallback();           break;
-    case Continue:              if (mContinueCallback != nullptr)              mContinueCallback();        break;
-    case Stop:                  if (mStopCallback != nullptr)                  mStopCallback();            break;
-    case ActiveSensing:         if (mActiveSensingCallback != nullptr)         mActiveSensingCallback();   break;
-
-        // Continuous controllers
-    case ControlChange:         if (mControlChangeCallback != nullptr)         mControlChangeCallback(_midiMessage.channel, _midiMessage.data1, _midiMessage.data2);    break;
-    case PitchBend:             if (mPitchBendCallback != nullptr)             mPitchBendCallback(_midiMessage.channel, (int)((_midiMessage.data1 & 0x7f) | ((_midiMessage.data2 & 0x7f) << 7)) + MIDI_PITCHBEND_MIN); break;
-    case AfterTouchPoly:        if (mAfterTouchPolyCallback != nullptr)        mAfterTouchPolyCallback(_midiMessage.channel, _midiMessage.data1, _midiMessage.data2);    break;
-    case AfterTouchChannel:     if (mAfterTouchChannelCallback != nullptr)     mAfterTouchChannelCallback(_midiMessage.channel, _midiMessage.data1);    break;
-
-    case ProgramChange:         if (mProgramChangeCallback != nullptr)         mProgramChangeCallback(_midiMessage.channel, _midiMessage.data1);    break;
-    case SystemExclusive:       if (mSystemExclusiveCallback != nullptr)       mSystemExclusiveCallback(_midiMessage.sysexArray, _midiMessage.getSysExSize());    break;
-
-        // Occasional messages
-    case TimeCodeQuarterFrame:  if (mTimeCodeQuarterFrameCallback != nullptr)  mTimeCodeQuarterFrameCallback(_midiMessage.data1);    break;
-    case SongPosition:          if (mSongPositionCallback != nullptr)          mSongPositionCallback(unsigned((_midiMessage.data1 & 0x7f) | ((_midiMessage.data2 & 0x7f) << 7)));    break;
-    case SongSelect:            if (mSongSelectCallback != nullptr)            mSongSelectCallback(_midiMessage.data1);    break;
-    case TuneRequest:           if (mTuneRequestCallback != nullptr)           mTuneRequestCallback();    break;
-
-    case SystemReset:           if (mSystemResetCallback != nullptr)           mSystemResetCallback();    break;
-
-    case InvalidType:
+    entry.thunk(*this, entry);
+  }
+  if ((_mHooks & HookDecoder) && _midiMessage.type == ControlChange)
+  {
+    decodeParameter();
+  }
+}
+/************************************************************************* 
+Description:    Launch the optional receive hooks before the callback of the type
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Called by launchCallback() only when a hook is set
+**************************************************************************/
+void MidiInterfaceCore::launchHooks(void)
+{
+  if ((_mHooks & HookNoteTracker) && (_midiMessage.type == NoteOn || _midiMessage.type == NoteOff))
+  {
+    if (_midiMessage.type == NoteOn && _midiMessage.data2 != 0)
+    {
+      _mNoteTracker->noteOn(_midiMessage.channel, _midiMessage.data1);
+    }
+    else
+    {
+      _mNoteTracker->noteOff(_midiMessage.channel, _midiMessage.data1);
+    }
+  }
+  if (_mHooks & HookRecorder)
+  {
+    _mRecorder->record(_midiMessage, _mSysExBuffer, (_mClock == micros) ? _mMessageTime : uint32_t(micros()));
+  }
+  if (_mHooks & HookClock)
+  {
+    measureDispatchDelay();
+  }
+  if (_mHooks & HookDecoder)
+  {
+    launchParameterEvent(_mParameterDecoder->release(_midiMessage.type, _midiMessage.channel, _midiMessage.data1));
+  }
+  if (_mHooks & HookMessage)
+  {
+    _mMessageEntry.thunk(*this, _mMessageEntry);
+  }
+}
+/************************************************************************* 
+Description:    Give the parameter decoder the received Control Change and
+                launch its event
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Launched after the Control Change callback
+**************************************************************************/
+void MidiInterfaceCore::decodeParameter(void)
+{
+  launchParameterEvent(_mParameterDecoder->decode(_midiMessage.channel, _midiMessage.data1, _midiMessage.data2));
+  if (_mParameterDecoder->isWaiting())
+  {
+    _mParameterTime = micros();//An MSB waits for its LSB
+  }
+}
+/************************************************************************* 
+Description:    Set the HookXxx bits of the receive hooks set
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Called by the setters of the hooks
+**************************************************************************/
+void MidiInterfaceCore::updateHooks(void)
+{
+  uint8_t hooks = 0;
+  if (_mNoteTracker != nullptr && (_mNoteSources & MIDI_TRACK_RECEIVED))
+  {
+    hooks |= HookNoteTracker;
+  }
+  if (_mRecorder != nullptr)
+  {
+    hooks |= HookRecorder;
+  }
+  if (_mClock != nullptr)
+  {
+    hooks |= HookClock;
+  }
+  if (_mParameterDecoder != nullptr)
+  {
+    hooks |= HookDecoder;
+  }
+  if (_mMessageEntry.thunk != nullptr)
+  {
+    hooks |= HookMessage;
+  }
+  _mHooks = hooks;
+}
+/************************************************************************* 
+Description:    Launch the RPN, NRPN or 14-bit controller callback of a
+                parameter decoder event
+parameter:
+    Input:      event：the event returned by the decoder
+    Output:         
+Return:         
+Others:         The event of a received Control Change is launched after its
+                callback, the event of a waiting MSB before the callbacks of
+                the message releasing it
+**************************************************************************/
+void MidiInterfaceCore::launchParameterEvent(uint8_t event)
+{
+  const uint8_t channel = _mParameterDecoder->getChannel();
+  switch (event)
+  {
+    case MIDI_PARAMETER_RPN:
+      if (mRpnCallback != nullptr)
+      {
+        mRpnCallback(channel, _mParameterDecoder->getNumber(), _mParameterDecoder->getValue());
+      }
+      break;
+    case MIDI_PARAMETER_NRPN:
+      if (mNrpnCallback != nullptr)
+      {
+        mNrpnCallback(channel, _mParameterDecoder->getNumber(), _mParameterDecoder->getValue());
+      }
+      break;
+    case MIDI_PARAMETER_CC14:
+      if (mControlChange14Callback != nullptr)
+      {
+        mControlChange14Callback(channel, uint8_t(_mParameterDecoder->getNumber()), _mParameterDecoder->getValue());
+      }
+      break;
     default:
-        break; // LCOV_EXCL_LINE - Unreacheable code, but prevents unhandled case warning.
+      break;
+  }
+}
+/************************************************************************* 
+Description:    Give the event of an MSB alone once it has waited
+                MIDI_PARAMETER_TIMEOUT for its LSB
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Called by isMIDIMessageOK() when no message is received, so
+                the event of an MSB alone is not held until the next message
+**************************************************************************/
+void MidiInterfaceCore::checkParameterTimeout(void)
+{
+  if (_mParameterDecoder->isWaiting() && uint32_t(micros() - _mParameterTime) >= MIDI_PARAMETER_TIMEOUT)
+  {
+    launchParameterEvent(_mParameterDecoder->flush());
   }
 }
+/************************************************************************* 
+Description:    Callback thunks: call the callback of the entry with the fields of
+                the message being dispatched
+parameter:
+    Input:      midi：the interface
+                entry：the dispatch table entry
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiInterfaceCore::launchChannelData(MidiInterfaceCore &midi, const MidiDispatchEntry &entry)
+{
+    entry.callback.channelData(midi._midiMessage.channel, midi._midiMessage.data1, midi._midiMessage.data2);
+}
+void MidiInterfaceCore::launchChannelValue(MidiInterfaceCore &midi, const MidiDispatchEntry &entry)
+{
+    entry.callback.channelValue(midi._midiMessage.channel, midi._midiMessage.data1);
+}
+void MidiInterfaceCore::launchPitchBend(MidiInterfaceCore &midi, const MidiDispatchEntry &entry)
+{
+    entry.callback.pitchBend(midi._midiMessage.channel, (int)((midi._midiMessage.data1 & 0x7f) | ((midi._midiMessage.data2 & 0x7f) << 7)) + MIDI_PITCHBEND_MIN);
+}
+void MidiInterfaceCore::launchSystemExclusive(MidiInterfaceCore &midi, const MidiDispatchEntry &entry)
+{
+    entry.callback.systemExclusive(midi._mSysExBuffer, uint16_t(midi._midiMessage.data2 << 8 | midi._midiMessage.data1));
+}
+void MidiInterfaceCore::launchSystemData(MidiInterfaceCore &midi, const MidiDispatchEntry &entry)
+{
+    entry.callback.systemData(midi._midiMessage.data1);
+}
+void MidiInterfaceCore::launchSongPosition(MidiInterfaceCore &midi, const MidiDispatchEntry &entry)
+{
+    entry.callback.songPosition(unsigned((midi._midiMessage.data1 & 0x7f) | ((midi._midiMessage.data2 & 0x7f) << 7)));
+}
+void MidiInterfaceCore::launchRealTime(MidiInterfaceCore &, const MidiDispatchEntry &entry)
+{
+    entry.callback.realTime();
+}
+void MidiInterfaceCore::launchMessage(MidiInterfaceCore &midi, const MidiDispatchEntry &entry)
+{
+    entry.callback.message(midi._midiMessage);
+}
+void MidiInterfaceCore::launchHandler(MidiInterfaceCore &midi, const MidiDispatchEntry &entry)
+{
+    entry.callback.handler(midi._mHandlerContext, midi._midiMessage);
+}
 
@@ -13,17 +13,42 @@ https://www.midi.org/specifications/midi1-specifications/m1-v4-2-1-midi-1-0-deta
 #ifndef  _BMV51M001_H
 #define  _BMV51M001_H
 
-#include "Arduino.h"
 #include "BM_MIDIDefine.h"
+#include "BM_MIDIRing.h"
+#include "BM_MIDINoteTracker.h"
+#include "BM_MIDIControllerCache.h"
+#include "BM_MIDIParameterDecoder.h"
+#include "BM_MIDIFileRecorder.h"
 
 
-/*****************class for the MIDI*******************/
-class BMV51M001
+//Writes a block of bytes to the transport(see BasicMidiInterface)
+using MidiWriteFunction = size_t (*)(void *transport, const uint8_t *array, size_t length);
+//Returns the free space of the transport transmit buffer(see BasicMidiInterface)
+using MidiWriteSpaceFunction = int (*)(void *transport);
+
+class MidiInterfaceCore;
+
+/*Entry of the callback dispatch table: the thunk unpacks the message for the callback.
+  4 bytes on AVR: the handler context is kept once per interface*/
+struct MidiDispatchEntry{
+    void (*thunk)(MidiInterfaceCore &midi, const MidiDispatchEntry &entry);//nullptr:no callback
+    union{
+        void (*channelData)(uint8_t, uint8_t, uint8_t);//NoteOff, NoteOn, AfterTouchPoly, ControlChange
+        void (*channelValue)(uint8_t, uint8_t);//ProgramChange, AfterTouchChannel
+        PitchBendCallback pitchBend;
+        SystemExclusiveCallback systemExclusive;
+        void (*systemData)(uint8_t);//TimeCodeQuarterFrame, SongSelect
+        SongPositionCallback songPosition;
+        void (*realTime)(void);//TuneRequest and the real-time messages
+        void (*message)(const MidiMessage &);
+        MidiHandler handler;
+    } callback;
+};
+
+/*****************class for the MIDI(transport independent part)*******************/
+class MidiInterfaceCore
 {
 public:
-    BMV51M001(HardwareSerial *theSerial  = &Serial);
-    //default receive data on channel 0
-	void begin(uint8_t inputChannel = 1);
 	/******************************************MIDI OUT*************************************/
     /*CHANNEL VOICE MESSAGES*/
 	void send(MidiType type, uint8_t data1, uint8_t data2, uint8_t channel);  
@@ -34,8 +59,10 @@ public:
     void sendProgramChange(uint8_t programNumber, uint8_t channel);
     void sendAfterTouch(uint8_t pressure, uint8_t channel);
     void sendPitchBend(int16_t pitchValue, uint8_t channel);
+    void sendEvents(const MidiEvent *events, size_t count);
     /*SYSTEM EXCLUSIVE MESSAGES*/
     void sendSysEx(uint16_t length, const uint8_t* array, bool arrayContainsBoundaries = false);
+    void writeRaw(const uint8_t *array, uint16_t length);
     /*SYSTEM COMMON MESSAGES*/
     void sendTimeCodeQuarterFrame(uint8_t typeNibble, uint8_t valuesNibble);
     void sendTimeCodeQuarterFrame(uint8_t data);
@@ -58,14 +85,43 @@ public:
     void sendRpnIncrement(uint8_t amount, uint8_t channel);
     void sendRpnDecrement(uint8_t amount, uint8_t channel);
     void endRpn(uint8_t channel);
+    void sendRpn(uint16_t number, uint16_t value, uint8_t channel);
     void beginNrpn(uint16_t number, uint8_t channel);
     void sendNrpnValue(uint16_t value, uint8_t channel);
     void sendNrpnValue(uint8_t msb, uint8_t lsb, uint8_t channel);
     void sendNrpnIncrement(uint8_t amount,uint8_t channel);
     void sendNrpnDecrement(uint8_t amount, uint8_t channel);
     void endNrpn(uint8_t channel);
+    void sendNrpn(uint16_t number, uint16_t value, uint8_t channel);
+    /*RUNNING STATUS*/
+    void setRunningStatus(bool enable, bool foldNoteOff = false, uint16_t refreshTime = 0);
+    uint32_t getRunningStatusSavedBytes(void);
+    /*TRANSMIT BUFFER*/
+    void beginBatch(void);
+    void flush(void);
+    void setTransmitQueue(bool enable);
+    void serviceOutput(void);
+    uint8_t getTransmitQueueCount(void);
+    void setGovernor(bool enable);
+    uint16_t getGovernorBacklog(void);
+    uint8_t getGovernorHeldCount(void);
+    uint32_t getGovernorDroppedCount(void);
+    /*ACTIVE NOTES*/
+    void setNoteTracker(MidiNoteTracker *tracker, uint8_t sources = MIDI_TRACK_SENT | MIDI_TRACK_RECEIVED);
+    MidiNoteTracker *getNoteTracker(void) { return _mNoteTracker; }
+    void panic(void);
+    /*CONTROLLER CACHE*/
+    void setControllerCache(MidiControllerCache *cache);
+    MidiControllerCache *getControllerCache(void) { return _mControllerCache; }
+    void resendAll(void);
+    uint32_t getCacheSavedBytes(void);
     /******************************************MIDI IN*************************************/
-    bool isMIDIMessageOK(void);
+    void setDrainMode(bool enable, uint16_t byteBudget = 0, uint16_t timeBudget = 0);
+    uint16_t getQueueOverflowCount(void);
+    void setInterruptMode(bool enable);
+    void setInputCoalescing(bool enable);
+    uint32_t getCoalescedCount(void);
+    bool pop(MidiPacket &message);
     void getMIDIMessage(uint8_t array[]);
     bool inputFilter(uint8_t channel);  
     MidiType getMessageType(void);
@@ -73,59 +129,116 @@ public:
     uint8_t getMessageData1(void);
     uint8_t getMessageData2(void);
     uint8_t getSysExArray(uint8_t dataBuffer[]); 
+    MidiSysEx getSysEx(void);
+    void setSysExStream(uint8_t *buffer, uint16_t size, SysExChunkCallback fptr);
     bool checkMessageValid(void);
+    void setTimestamp(bool enable, MidiClockFunction clock = micros);
+    uint32_t getMessageTimestamp(void);
+    MidiDelayStats getDispatchDelay(void);
+    void resetDispatchDelay(void);
     uint8_t getInputChannel(void);
     void setInputChannel(uint8_t inputChannel);
+    void setChannelMask(uint16_t mask);
+    uint16_t getChannelMask(void);
+    void setTypeMask(uint32_t mask);
+    uint32_t getTypeMask(void);
+    void setTypeFilter(MidiType type, bool accept);
+    void setParameterDecoder(MidiParameterDecoder *decoder);
+    MidiParameterDecoder *getParameterDecoder(void) { return _mParameterDecoder; }
+    void setRecorder(MidiFileRecorder *recorder);
+    MidiFileRecorder *getRecorder(void) { return _mRecorder; }
+    /*SOFT MIDI THRU*/
+    void setThru(MidiInterfaceCore *output);
+    void setThruChannelMask(uint16_t mask);
+    void setThruTypeMask(uint32_t mask);
+    uint32_t getThruByteCount(void);
 /******************************************MIDI Callbacks*************************************/
 public:
-    void setHandleMessage(void (*fptr)(const MidiMessage&)) { mMessageCallback = fptr; };
-    void setHandleNoteOff(NoteOffCallback fptr) { mNoteOffCallback = fptr; }
-    void setHandleNoteOn(NoteOnCallback fptr) { mNoteOnCallback = fptr; }
-    void setHandleAfterTouchPoly(AfterTouchPolyCallback fptr) { mAfterTouchPolyCallback = fptr; }
-    void setHandleControlChange(ControlChangeCallback fptr) { mControlChangeCallback = fptr; }
-    void setHandleProgramChange(ProgramChangeCallback fptr) { mProgramChangeCallback = fptr; }
-    void setHandleAfterTouchChannel(AfterTouchChannelCallback fptr) { mAfterTouchChannelCallback = fptr; }
-    void setHandlePitchBend(PitchBendCallback fptr) { mPitchBendCallback = fptr; }
-    void setHandleSystemExclusive(SystemExclusiveCallback fptr) { mSystemExclusiveCallback = fptr; }
-    void setHandleTimeCodeQuarterFrame(TimeCodeQuarterFrameCallback fptr) { mTimeCodeQuarterFrameCallback = fptr; }
-    void setHandleSongPosition(SongPositionCallback fptr) { mSongPositionCallback = fptr; }
-    void setHandleSongSelect(SongSelectCallback fptr) { mSongSelectCallback = fptr; }
-    void setHandleTuneRequest(TuneRequestCallback fptr) { mTuneRequestCallback = fptr; }
-    void setHandleClock(ClockCallback fptr) { mClockCallback = fptr; }
-    void setHandleStart(StartCallback fptr) { mStartCallback = fptr; }
-    void setHandleContinue(ContinueCallback fptr) { mContinueCallback = fptr; }
-    void setHandleStop(StopCallback fptr) { mStopCallback = fptr; }
-    void setHandleActiveSensing(ActiveSensingCallback fptr) { mActiveSensingCallback = fptr; }
-    void setHandleSystemReset(SystemResetCallback fptr) { mSystemResetCallback = fptr; }
+    void setHandleMessage(void (*fptr)(const MidiMessage&));
+    void setHandleMessage(MidiHandler handler, void *context);
+    void setHandleNoteOff(NoteOffCallback fptr) { connectCallback(NoteOff, fptr); }
+    void setHandleNoteOn(NoteOnCallback fptr) { connectCallback(NoteOn, fptr); }
+    void setHandleAfterTouchPoly(AfterTouchPolyCallback fptr) { connectCallback(AfterTouchPoly, fptr); }
+    void setHandleControlChange(ControlChangeCallback fptr) { connectCallback(ControlChange, fptr); }
+    void setHandleProgramChange(ProgramChangeCallback fptr) { connectCallback(ProgramChange, fptr); }
+    void setHandleAfterTouchChannel(AfterTouchChannelCallback fptr) { connectCallback(AfterTouchChannel, fptr); }
+    void setHandlePitchBend(PitchBendCallback fptr) { connectCallback(PitchBend, fptr); }
+    void setHandleSystemExclusive(SystemExclusiveCallback fptr) { connectCallback(SystemExclusive, fptr); }
+    void setHandleTimeCodeQuarterFrame(TimeCodeQuarterFrameCallback fptr) { connectCallback(TimeCodeQuarterFrame, fptr); }
+    void setHandleSongPosition(SongPositionCallback fptr) { connectCallback(SongPosition, fptr); }
+    void setHandleSongSelect(SongSelectCallback fptr) { connectCallback(SongSelect, fptr); }
+    void setHandleTuneRequest(TuneRequestCallback fptr) { connectCallback(TuneRequest, fptr); }
+    void setHandleClock(ClockCallback fptr) { connectCallback(Clock, fptr); }
+    void setHandleStart(StartCallback fptr) { connectCallback(Start, fptr); }
+    void setHandleContinue(ContinueCallback fptr) { connectCallback(Continue, fptr); }
+    void setHandleStop(StopCallback fptr) { connectCallback(Stop, fptr); }
+    void setHandleActiveSensing(ActiveSensingCallback fptr) { connectCallback(ActiveSensing, fptr); }
+    void setHandleSystemReset(SystemResetCallback fptr) { connectCallback(SystemReset, fptr); }
+    void setHandleRpn(RpnCallback fptr) { mRpnCallback = fptr; }
+    void setHandleNrpn(NrpnCallback fptr) { mNrpnCallback = fptr; }
+    void setHandleControlChange14(ControlChange14Callback fptr) { mControlChange14Callback = fptr; }
+    void setHandler(MidiType type, MidiHandler handler, void *context = nullptr);
+    void setHandleReceivedByte(MidiByteHandler handler, void *context);
     void disconnectCallbackFromType(MidiType type);
 
-private:
+protected:
+    MidiInterfaceCore(void *transport, MidiWriteFunction writeFunction, MidiWriteSpaceFunction writeSpaceFunction);
+    void initialize(uint8_t inputChannel);//reset the MIDI state
+
     void launchCallback();//Callback funtion
-    void (*mMessageCallback)(const MidiMessage& message) = nullptr;
-    NoteOffCallback mNoteOffCallback = nullptr;
-    NoteOnCallback mNoteOnCallback = nullptr;
-    AfterTouchPolyCallback mAfterTouchPolyCallback = nullptr;
-    ControlChangeCallback mControlChangeCallback = nullptr;
-    ProgramChangeCallback mProgramChangeCallback = nullptr;
-    AfterTouchChannelCallback mAfterTouchChannelCallback = nullptr;
-    PitchBendCallback mPitchBendCallback = nullptr;
-    SystemExclusiveCallback mSystemExclusiveCallback = nullptr;
-    TimeCodeQuarterFrameCallback mTimeCodeQuarterFrameCallback = nullptr;
-    SongPositionCallback mSongPositionCallback = nullptr;
-    SongSelectCallback mSongSelectCallback = nullptr;
-    TuneRequestCallback mTuneRequestCallback = nullptr;
-    ClockCallback mClockCallback = nullptr;
-    StartCallback mStartCallback = nullptr;
-    TickCallback mTickCallback = nullptr;
-    ContinueCallback mContinueCallback = nullptr;
-    StopCallback mStopCallback = nullptr;
-    ActiveSensingCallback mActiveSensingCallback = nullptr;
-    SystemResetCallback mSystemResetCallback = nullptr;
+    void launchHooks(void);//note tracker, recorder, dispatch delay, decoder release, every-message handler
+    void decodeParameter(void);//parameter decoder event of a received Control Change
+    void updateHooks(void);//set _mHooks from the hooks set
+    //_mHooks bits: one test skips all the optional receive hooks
+    static const uint8_t HookNoteTracker = 0x01;
+    static const uint8_t HookRecorder = 0x02;
+    static const uint8_t HookClock = 0x04;
+    static const uint8_t HookDecoder = 0x08;
+    static const uint8_t HookMessage = 0x10;
+    //One handler per type index: the thunk calls it with the arguments of its signature
+    void connectCallback(MidiType type, void (*fptr)(uint8_t, uint8_t, uint8_t));
+    void connectCallback(MidiType type, void (*fptr)(uint8_t, uint8_t));
+    void connectCallback(MidiType type, void (*fptr)(uint8_t, int16_t));
+    void connectCallback(MidiType type, void (*fptr)(uint8_t *, uint16_t));
+    void connectCallback(MidiType type, void (*fptr)(uint8_t));
+    void connectCallback(MidiType type, void (*fptr)(uint16_t));
+    void connectCallback(MidiType type, void (*fptr)(void));
+    static void launchChannelData(MidiInterfaceCore &midi, const MidiDispatchEntry &entry);
+    static void launchChannelValue(MidiInterfaceCore &midi, const MidiDispatchEntry &entry);
+    static void launchPitchBend(MidiInterfaceCore &midi, const MidiDispatchEntry &entry);
+    static void launchSystemExclusive(MidiInterfaceCore &midi, const MidiDispatchEntry &entry);
+    static void launchSystemData(MidiInterfaceCore &midi, const MidiDispatchEntry &entry);
+    static void launchSongPosition(MidiInterfaceCore &midi, const MidiDispatchEntry &entry);
+    static void launchRealTime(MidiInterfaceCore &midi, const MidiDispatchEntry &entry);
+    static void launchMessage(MidiInterfaceCore &midi, const MidiDispatchEntry &entry);
+    static void launchHandler(MidiInterfaceCore &midi, const MidiDispatchEntry &entry);
+    MidiDispatchEntry   _mMessageEntry;//handler of every message(setHandleMessage)
+    MidiDispatchEntry   _mDispatch[MIDI_TYPE_COUNT];//handler of each type, indexed by midiTypeIndex()
+    void               *_mHandlerContext;//context passed to the setHandler()/setHandleMessage() handlers
+    uint8_t             _mHooks;//HookXxx bits of the hooks set, 0:none
+    MidiByteHandler     mByteHandler = nullptr;//raw received bytes(merger...)
+    void               *mByteContext = nullptr;
+    SysExChunkCallback mSysExChunkCallback = nullptr;
+    RpnCallback mRpnCallback = nullptr;//parameter decoder events
+    NrpnCallback mNrpnCallback = nullptr;
+    ControlChange14Callback mControlChange14Callback = nullptr;
     
     //Call some things before sending
-	bool beginTransmission(MidiType){return true;};
-    //Call some things after sending
-	void endTransmission(){};
+	bool beginTransmission(MidiType);
+    //Call some things after sending(flush the staged bytes)
+	void endTransmission(void);
+    void txByte(uint8_t data);//stage one byte
+    void txBytes(const uint8_t *array, uint16_t length);//stage several bytes
+    void flushTx(void);//write the staged bytes with one write()
+    void queueTx(const uint8_t *array, uint16_t length);//queued mode:append bytes to the transmit queue
+    void writeQueuedByte(void);//queued mode:write the next byte, real-time first
+    void writeQueuedBytes(void);//queued mode:write while the serial port holds less than MIDI_TX_UART_DEPTH bytes
+    void countWireBytes(uint16_t length);//governor:add bytes to the wire backlog
+    bool holdValue(MidiType type, uint8_t data1, uint8_t data2, uint8_t channel);//governor:hold a continuous message
+    void releaseHeldValues(void);//governor:send the held messages
+    uint8_t eventStatus(const MidiEvent &event);//status byte of a sendEvents() message
+    void selectParameter(uint8_t select, uint16_t number, uint8_t channel);//send the RPN/NRPN number bytes that changed
+    void resetParameterSelect(void);//the parameter selected on each channel is unknown
     //is ChannelMessage?(see midi protocol)
     bool isChannelMessage(MidiType type);
     //get  type info from status(the first byte)
@@ -133,21 +246,294 @@ private:
     //get  channel info from status
     static uint8_t getChannelFromStatusByte(uint8_t status);
     void resetInput(void);//Clear this receiving completion flag bit
-    bool parse(void);//parse message
-private:/* Internal variables */
-    HardwareSerial *_serial = NULL;
+    bool parseByte(uint8_t extracted);//parse one received byte
+    void streamSysExByte(uint8_t data, bool last);//streaming SysEx:store a byte, deliver the chunks
+    bool receiveByte(uint8_t extracted);//parse, filter and launch the callbacks
+    void drainByte(uint8_t extracted);//drain mode:parse, launch the callbacks and queue
+    void serviceByte(uint8_t extracted);//interrupt mode:parse and queue
+    bool dispatchQueuedMessage(void);//interrupt mode:pop and launch the callbacks
+    bool popQueuedMessage(void);//move the oldest queued message to _midiMessage
+    bool popLatest(MidiPacket &message, uint32_t &time);//pop the oldest queued message, skipping the outdated values
+    void loadMessage(const MidiPacket &message, uint32_t time);//copy a parsed message to _midiMessage
+    void queueParsed(void);//queue _mParsed(producer side), a queued SysEx keeps the SysEx buffer
+    void resetQueue(void);//empty the receive queue, release the SysEx buffer
+    void releaseSysEx(void);//consumer:release the SysEx buffer once the popped SysEx has been read
+    bool canDrain(void);//drain mode:true if a message completed by the next byte can be queued
+    void setSysExArray(void);//point the deprecated MidiMessage::sysexArray to the SysEx payload
+    static bool isListened(MidiType type, uint8_t messageChannel, uint8_t channel);
+    void measureDispatchDelay(void);//update the receive-to-dispatch statistics
+    void launchParameterEvent(uint8_t event);//parameter decoder:launch the callback of an event
+    void checkParameterTimeout(void);//parameter decoder:give an MSB alone after MIDI_PARAMETER_TIMEOUT
+    void thruByte(uint8_t extracted);//soft thru:forward a received byte to the output
+    void thruWrite(uint8_t data);//soft thru:write a forwarded byte(called on the output)
+protected:/* Internal variables */
+    void               *_mTransport;
+    MidiWriteFunction   _mWrite;
+    MidiWriteSpaceFunction _mWriteSpace;
     uint8_t             _mInputChannel;
+    uint16_t            _mChannelMask;//accepted channels, bit 0:channel 1
+    uint32_t            _mTypeMask;//accepted types, bit midiTypeIndex(type)
     uint8_t             _mRunningStatus_TX;//Used to store status bytes
     uint8_t             _mRunningStatus_RX;//Used to store status bytes
-    bool                _mRunningStatus;//true:use running status；false:not use running ststua
     unsigned            _mPendingMessageIndex;
     uint8_t             _mPendingMessage[3];
     uint8_t             _mMidiDatabytes;
-    unsigned            _mCurrentRpnNumber;
-    unsigned            _mCurrentNrpnNumber;
+    MidiType            _mPendingType;//type of the pending message(or of the running status)
+    uint8_t             _mPendingFlags;//MIDI_STATUS_xxx flags of the pending message
+    uint8_t             _mParameterSelect[16];//per channel:MIDI_PARAMETER_RPN or MIDI_PARAMETER_NRPN last selected
+    uint8_t             _mParameterMsb[16];//per channel:parameter number MSB sent, 0xff:unknown
+    uint8_t             _mParameterLsb[16];//per channel:parameter number LSB sent, 0xff:unknown
     MidiMessage         _midiMessage;
-    bool                _useRunningStatus;
+    uint32_t            _mMessageTime;//arrival time of _midiMessage(see setTimestamp)
+    uint8_t             _mSysExArray[SYS_EX_MAXSIZE];//System Exclusive dedicated byte array
+    bool                _useRunningStatus;//true:use running status；false:not use running ststua
+    bool                _mFoldNoteOff;//true:send NoteOff as NoteOn with 0 velocity
+    uint16_t            _mRunningStatusRefresh;//ms,0:never resend the running status
+    unsigned long       _mRunningStatusTime;//last time the running status was sent
+    uint32_t            _mRunningStatusSaved;//number of status bytes not sent
+    uint8_t             _mTxBuffer[MIDI_TX_BUFFER_SIZE];//bytes staged between beginTransmission() and endTransmission()
+    uint8_t             _mTxLength;
+    bool                _mTxBatch;//true:flush() is called by the user
+    bool                _mTxQueued;//true:bytes are written by serviceOutput(), real-time first
+    int                 _mTxUartSize;//largest free space seen in the serial port buffer
+    MidiRing<uint8_t, MIDI_TX_QUEUE_SIZE> _mTxQueue;//queued mode:channel, common and SysEx bytes
+    MidiRing<uint8_t, MIDI_TX_REALTIME_SIZE> _mTxRealTime;//queued mode:real-time bytes
+    bool                _mGovernor;//true:continuous messages are coalesced when the wire is saturated
+    bool                _mGovernorRelease;//true:the held messages are being sent
+    bool                _mRawSysEx;//true:a SysEx written by writeRaw() is not ended, the held messages wait
+    unsigned long       _mWireFree;//us, estimated time the bytes handed so far are on the wire
+    uint8_t             _mGovernorCount;//held messages
+    MidiEvent           _mGovernorHeld[MIDI_GOVERNOR_SLOTS];//latest value of each held(channel, controller), in arrival order
+    uint32_t            _mGovernorDropped;//values replaced before being sent
+    bool                _mDrainMode;//true:parse all buffered bytes per call
+    uint16_t            _mDrainByteBudget;//0:no limit
+    uint16_t            _mDrainTimeBudget;//us,0:no limit
+    volatile bool       _mInterruptMode;//true:bytes are parsed by serviceInput()
+    MidiRing<MidiPacket, MIDI_RX_QUEUE_SIZE> _mRxQueue;//drain queue or interrupt ring
+    uint32_t            _mRxTimes[MIDI_RX_QUEUE_SIZE];//arrival time of the message in each slot of _mRxQueue
+    MidiPacket          _mParsed;//last message completed by the parser
+    uint32_t            _mParsedTime;//arrival time of _mParsed
+    bool                _mCoalesce;//true:a queued continuous message with a newer value queued is skipped
+    uint32_t            _mCoalesced;//queued messages skipped for a newer value
+    uint8_t             _mSysExCarry;//last byte of a split SysEx
+    bool                _mSysExSplit;//true:re-seed the SysEx buffer with the next byte
+    volatile bool       _mSysExBusy;//true:a queued SysEx owns the SysEx buffer until the consumer releases it
+    bool                _mSysExPopped;//true:the last popped message is a SysEx, released at the next pop
+    uint16_t            _mSysExDropped;//SysEx dropped because the SysEx buffer was busy
+    uint8_t            *_mSysExBuffer;//SysEx payload:_mSysExArray or the stream buffer
+    uint8_t            *_mSysExStream;//user buffer of the streaming SysEx mode, nullptr:not used
+    uint16_t            _mSysExCapacity;//size of the stream buffer
+    uint16_t            _mSysExLength;//bytes in the stream buffer
+    bool                _mSysExFirst;//true:the stream buffer holds the start of the SysEx
+    MidiClockFunction   _mClock;//timestamp clock, nullptr:no timestamp
+    uint32_t            _mPendingTime;//arrival time of the pending message
+    uint32_t            _mDelayMin;
+    uint32_t            _mDelayMax;
+    uint32_t            _mDelaySum;//sum of _mDelaySamples delays(halved with it before overflow)
+    uint32_t            _mDelaySamples;
+    uint32_t            _mDelayCount;
+    MidiInterfaceCore  *_mThruOutput;//soft thru output, nullptr:thru off
+    uint16_t            _mThruChannelMask;//forwarded channels, bit 0:channel 1
+    uint32_t            _mThruTypeMask;//forwarded types, bit midiTypeIndex(type)
+    uint8_t             _mThruStatus;//status of the message being forwarded, 0:none
+    uint8_t             _mThruLength;//data bytes of the message being forwarded
+    uint8_t             _mThruIndex;//data bytes already forwarded
+    bool                _mThruPass;//true:the message passes the thru filters
+    uint8_t             _mThruWire;//output side:status on the wire written by a thru, 0:other
+    uint32_t            _mThruBytes;//bytes forwarded
+    MidiNoteTracker    *_mNoteTracker;//active notes, nullptr:not tracked
+    uint8_t             _mNoteSources;//MIDI_TRACK_SENT, MIDI_TRACK_RECEIVED
+    MidiParameterDecoder *_mParameterDecoder;//RPN/NRPN/14-bit decoder of the received CC, nullptr:off
+    uint32_t            _mParameterTime;//us, time the decoder started to wait for an LSB
+    MidiFileRecorder   *_mRecorder;//records the received messages, nullptr:off
+    MidiControllerCache *_mControllerCache;//last values sent, nullptr:every send is written
+    uint32_t            _mCacheSaved;//bytes not sent because the value was cached
+};
+
+/*****************class for the MIDI on a given transport*******************/
+/**************************************************************************************
+Transport is any class with begin(unsigned long), available(), read(),
+availableForWrite() and write(const uint8_t*, size_t): HardwareSerial, SoftwareSerial, USB CDC or
+MidiMemoryTransport(BM_MIDITransport.h). Byte reception is inlined here,
+the parser and the encoder are shared by all the transports. The sends are
+not redefined here: the core stages the bytes and writes them with one call
+of writeTransport(), so a send is the same through a MidiInterfaceCore pointer.
+**************************************************************************************/
+template<class Transport>
+class BasicMidiInterface : public MidiInterfaceCore
+{
+public:
+    BasicMidiInterface(Transport *theTransport);
+    //default receive data on channel 1
+	void begin(uint8_t inputChannel = 1);
+    bool isMIDIMessageOK(void);
+    void serviceInput(void);
+
+protected:
+    void drainInput(void);//parse all buffered bytes and queue the messages
+    static size_t writeTransport(void *transport, const uint8_t *array, size_t length);
+    static int writeSpaceTransport(void *transport);
+    Transport          *_serial;
 };
 
+#if defined(ARDUINO)
+/*****************class for the MIDI on a HardwareSerial*******************/
+class BMV51M001 : public BasicMidiInterface<HardwareSerial>
+{
+public:
+    BMV51M001(HardwareSerial *theSerial  = &Serial) : BasicMidiInterface<HardwareSerial>(theSerial) {}
+};
 #endif
 
+/************************************************************************* 
+Description:    Constructor
+parameter:
+    Input:          *theTransport : the serial port(or any transport) the module is connected to
+    Output:         
+Return:         
+Others:         
+*************************************************************************/
+template<class Transport>
+BasicMidiInterface<Transport>::BasicMidiInterface(Transport *theTransport)
+    : MidiInterfaceCore(theTransport, &BasicMidiInterface<Transport>::writeTransport,
+                        &BasicMidiInterface<Transport>::writeSpaceTransport)
+{
+    _serial = theTransport; 
+}
+/************************************************************************* 
+Description:    MIDI communication initialization
+parameter:
+    Input:          inputChannel：Set the MIDI input channel(Unique Value 1)
+    Output:         
+Return:         
+Others:         
+*************************************************************************/
+template<class Transport>
+void BasicMidiInterface<Transport>::begin(uint8_t inputChannel)
+{
+    _serial->begin(31250);  
+    initialize(inputChannel);
+}
+/************************************************************************* 
+Description:    Read messages from the serial port using the main input channel.
+parameter:
+    Input:          
+    Output:         
+Return:         1: if a valid MIDI message
+                0: false if not.
+                A valid message is a message that matches the input channel.
+Others:         
+**************************************************************************/
+template<class Transport>
+bool BasicMidiInterface<Transport>::isMIDIMessageOK(void)
+{
+    if (_mTxQueued || _mGovernor)
+    {
+        serviceOutput();//Keep the transmit queue(and the governor) moving from the polling loop
+    }
+    if (_mInputChannel >= MIDI_CHANNEL_OFF)
+        return false; // MIDI Input disabled.
+
+    bool received;
+    if (_mInterruptMode)
+    {
+        //Bytes are parsed by serviceInput(), only dispatch here
+        received = dispatchQueuedMessage();
+    }
+    else if (_mDrainMode)
+    {
+        drainInput();
+        received = popQueuedMessage();
+    }
+    else
+    {
+        //Extract data from the serial port, if it received any
+        received = (_serial->available() != 0) && receiveByte(_serial->read());
+    }
+    if (!received && _mParameterDecoder != nullptr)
+    {
+        checkParameterTimeout();
+    }
+    return received;
+}
+/************************************************************************* 
+Description:    Parse all the received bytes into the message ring(producer side)
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Call it from serialEvent() or from the serial receive interrupt
+**************************************************************************/
+template<class Transport>
+void BasicMidiInterface<Transport>::serviceInput(void)
+{
+    if (!_mInterruptMode || _mInputChannel >= MIDI_CHANNEL_OFF)
+    {
+        return;
+    }
+    while (_serial->available() > 0)
+    {
+        serviceByte(_serial->read());
+    }
+}
+/************************************************************************* 
+Description:    Parse all the bytes buffered by the serial port(within the budget),
+                launch the callbacks and queue each completed message
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         The bytes arriving during the drain are left for the next call.
+                The drain stops while the queue is full or a queued SysEx holds
+                the SysEx buffer: the bytes wait in the serial port buffer.
+**************************************************************************/
+template<class Transport>
+void BasicMidiInterface<Transport>::drainInput(void)
+{
+    int count = _serial->available();
+    if (_mDrainByteBudget != 0 && count > _mDrainByteBudget)
+    {
+        count = _mDrainByteBudget;
+    }
+    const unsigned long start = micros();
+
+    releaseSysEx();//The SysEx popped by the previous call has been read
+    while (count-- > 0 && canDrain())
+    {
+        drainByte(_serial->read());
+        if (_mDrainTimeBudget != 0 && (micros() - start) >= _mDrainTimeBudget)
+        {
+            break;
+        }
+    }
+}
+/************************************************************************* 
+Description:    Write a block of bytes to the transport
+parameter:
+    Input:      transport：the transport object
+                array：the bytes
+                length：the number of bytes
+    Output:         
+Return:         the number of bytes written
+Others:         
+**************************************************************************/
+template<class Transport>
+size_t BasicMidiInterface<Transport>::writeTransport(void *transport, const uint8_t *array, size_t length)
+{
+    return static_cast<Transport *>(transport)->write(array, length);
+}
+/************************************************************************* 
+Description:    Get the free space of the transport transmit buffer
+parameter:
+    Input:      transport：the transport object
+    Output:         
+Return:         the number of bytes that can be written without blocking
+Others:         
+**************************************************************************/
+template<class Transport>
+int BasicMidiInterface<Transport>::writeSpaceTransport(void *transport)
+{
+    return static_cast<Transport *>(transport)->availableForWrite();
+}
+
+#endif
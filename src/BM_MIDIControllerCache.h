@@ -0,0 +1,112 @@
+/***************************************************************************
+File:       		BM_MIDIControllerCache.h
+Author:           BESTMODULE
+Description:      Cache of the last controller values sent on each channel
+                  (128 controllers, program, pitch bend, channel pressure),
+                  used to drop the sends that do not change a value
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；Arduino IDE : v1.8.19
+
+****************************************************************************/
+#ifndef _BM_MIDI_CONTROLLER_CACHE_H
+#define _BM_MIDI_CONTROLLER_CACHE_H
+
+#include "BM_MIDIDefine.h"
+
+/**************************************************************************************
+Channels are 1 to 16 like in the send functions. A value not sent yet reads
+MIDI_CACHE_UNKNOWN(MIDI_CACHE_UNKNOWN_14BIT for the pitch bend). The parameter
+number controllers(6, 38, 96 to 101) and the channel mode messages(120 to 127)
+are never cached: sending them again always has an effect. A new MSB(0 to 31)
+forgets the value of its LSB(32 to 63) and a new Bank Select(0, 32) forgets the
+program: receivers reset the LSB on each MSB, and a Program Change after a
+Bank Select loads the new bank even with the same number. The cache uses
+2112 bytes of RAM and is only present when the sketch builds one and attaches
+it(setControllerCache()).
+**************************************************************************************/
+class MidiControllerCache
+{
+public:
+    MidiControllerCache() { clear(); }
+
+    //Store a channel message, false if it does not change the cached value
+    bool update(MidiType type, uint8_t channel, uint8_t data1, uint8_t data2)
+    {
+        const uint8_t index = (channel - 1) & 0x0f;
+        switch (type)
+        {
+            case ControlChange:
+                if (!isCached(data1))
+                {
+                    return true;
+                }
+                if (!store(_control[index][data1 & 0x7f], data2))
+                {
+                    return false;
+                }
+                if (data1 < 32)
+                {
+                    _control[index][data1 + 32] = MIDI_CACHE_UNKNOWN;//The LSB is reset by the receiver
+                }
+                if (data1 == BankSelect || data1 == BankSelect + 32)
+                {
+                    _program[index] = MIDI_CACHE_UNKNOWN;//The Program Change loads the new bank
+                }
+                return true;
+            case ProgramChange:
+                return store(_program[index], data1);
+            case AfterTouchChannel:
+                return store(_pressure[index], data1);
+            case PitchBend:
+            {
+                const uint16_t value = uint16_t(data1 | (data2 << 7));
+                if (_pitchBend[index] == value)
+                {
+                    return false;
+                }
+                _pitchBend[index] = value;
+                return true;
+            }
+            default:
+                return true;
+        }
+    }
+    uint8_t getControl(uint8_t channel, uint8_t controlNumber) const { return _control[(channel - 1) & 0x0f][controlNumber & 0x7f]; }
+    uint8_t getProgram(uint8_t channel) const { return _program[(channel - 1) & 0x0f]; }
+    uint8_t getAfterTouch(uint8_t channel) const { return _pressure[(channel - 1) & 0x0f]; }
+    //14-bit value as sent on the wire(0 to 16383, 8192:center)
+    uint16_t getPitchBend(uint8_t channel) const { return _pitchBend[(channel - 1) & 0x0f]; }
+    static bool isCached(uint8_t controlNumber)
+    {
+        return controlNumber < 120 && controlNumber != 6 && controlNumber != 38
+            && (controlNumber < 96 || controlNumber > 101);
+    }
+    void clear(void)
+    {
+        memset(_control, MIDI_CACHE_UNKNOWN, sizeof(_control));
+        memset(_program, MIDI_CACHE_UNKNOWN, sizeof(_program));
+        memset(_pressure, MIDI_CACHE_UNKNOWN, sizeof(_pressure));
+        for (uint8_t i = 0; i < 16; i++)
+        {
+            _pitchBend[i] = MIDI_CACHE_UNKNOWN_14BIT;
+        }
+    }
+
+private:
+    static bool store(uint8_t &slot, uint8_t value)
+    {
+        if (slot == value)
+        {
+            return false;
+        }
+        slot = value;
+        return true;
+    }
+
+    uint8_t  _control[16][128];
+    uint8_t  _program[16];
+    uint8_t  _pressure[16];
+    uint16_t _pitchBend[16];
+};
+
+#endif
@@ -15,7 +15,16 @@ History：		  -
 MIDI Message：Divided into Channel Message and System Message
 Channel Message：Divided into Channel Voice Message and Channel Mode Message
 **************************************************************************************/
-//#include <Arduino.h>
+#if defined(ARDUINO)
+#include "Arduino.h"
+#else
+// Host build(tests, benchmarks): the program provides the time base
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+unsigned long micros(void);
+unsigned long millis(void);
+#endif
 
 #define     USE_RUNNING_STATUS      (true)
 #define     NOT_USE_RUNNING_STATUS  (false)
@@ -26,11 +35,39 @@ Channel Message：Divided into Channel Voice Message and Channel Mode Message
 #define     MIDI_CHANNEL_OFF        (17) // and over
 
 #define     SYS_EX_MAXSIZE          (128)
+#define     MIDI_SYSEX_START        (0x01) // SysEx chunk position: the chunk starts with 0xF0
+#define     MIDI_SYSEX_END          (0x02) // SysEx chunk position: the chunk ends with 0xF7
+#define     MIDI_TX_BUFFER_SIZE     (32) // Transmit staging buffer, flushed with one write()
+#define     MIDI_RX_QUEUE_SIZE      (16) // Receive ring of the drain/interrupt mode, power of two(one slot is kept free)
+#define     MIDI_TX_QUEUE_SIZE      (64) // Transmit queue of the queued mode, power of two(one slot is kept free)
+#define     MIDI_TX_REALTIME_SIZE   (8)  // Real-time bytes waiting to jump the transmit queue, power of two
+#define     MIDI_TX_UART_DEPTH      (2)  // Bytes the queued mode keeps in the serial port buffer(320us each)
+#define     MIDI_BYTE_TIME          (320) // us per byte on the wire at 31250 baud
+#define     MIDI_GOVERNOR_BACKLOG   (40) // Bytes of wire backlog from which the governor holds continuous messages
+#define     MIDI_PARAMETER_TIMEOUT  (3000) // us an MSB waits for its LSB before its event is given alone
+#define     MIDI_GOVERNOR_SLOTS     (16) // Continuous messages(channel, controller) the governor can hold
+#define     MIDI_TRACK_SENT         (0x01) // setNoteTracker():track the notes sent
+#define     MIDI_TRACK_RECEIVED     (0x02) // setNoteTracker():track the notes received
+#define     MIDI_CACHE_UNKNOWN      (0xff) // MidiControllerCache:value not sent yet
+#define     MIDI_CACHE_UNKNOWN_14BIT (0xffff) // MidiControllerCache:pitch bend not sent yet
+#define     MIDI_MERGE_PORTS        (4)  // Inputs of a MidiMerger
+#define     MIDI_MERGE_QUEUE_SIZE   (8)  // Messages held per input while a SysEx is merged, power of two
+#define     MIDI_MERGE_SYSEX_TIMEOUT (500) // ms without SysEx byte before the merger releases the output
+#define     MIDI_MERGE_SYSEX_SIZE   (64) // SysEx bytes held per input while another input's SysEx is merged, power of two
+#define     MIDI_FILE_TRACKS        (16) // Tracks a MidiFilePlayer can play
+#define     MIDI_FILE_BUFFER_SIZE   (8)  // Read buffer of each track(bytes)
+#define     MIDI_FILE_INDEX_SIZE    (4)  // Seek checkpoints kept by a MidiFilePlayer(fewer with many tracks, see MIDI_FILE_MARKS)
+#define     MIDI_FILE_MARKS         (32) // Track marks of the seek checkpoints, shared by the tracks of the file(at least 2 x MIDI_FILE_TRACKS)
+#define     MIDI_FILE_CHASE_SIZE    (9)  // Controllers chased by MidiFilePlayer::seek()
+#define     MIDI_FILE_DEFAULT_TEMPO (500000) // us per quarter note before the first tempo event(120 bpm)
+#define     MIDI_RECORD_BUFFER_SIZE (128) // Each of the two write buffers of a MidiFileRecorder(bytes)
+#define     MIDI_RECORD_DIVISION    (960) // Ticks per quarter note of the recorded files(120 bpm:520.8us per tick)
 
 
 // -----------------------------------------------------------------------------
 // Aliasing
 
+struct MidiMessage;
 using NoteOffCallback              = void (*)(uint8_t channel, uint8_t note, uint8_t velocity);
 using NoteOnCallback               = void (*)(uint8_t channel, uint8_t note, uint8_t velocity);
 using AfterTouchPolyCallback       = void (*)(uint8_t channel, uint8_t note, uint8_t velocity);
@@ -50,6 +87,13 @@ using ContinueCallback             = void (*)(void);
 using StopCallback                 = void (*)(void);
 using ActiveSensingCallback        = void (*)(void);
 using SystemResetCallback          = void (*)(void);
+using MidiClockFunction            = unsigned long (*)(void);
+using MidiHandler                  = void (*)(void *context, const MidiMessage &message);
+using MidiByteHandler              = void (*)(void *context, uint8_t data);
+using RpnCallback                  = void (*)(uint8_t channel, uint16_t number, uint16_t value);
+using NrpnCallback                 = void (*)(uint8_t channel, uint16_t number, uint16_t value);
+using ControlChange14Callback      = void (*)(uint8_t channel, uint8_t controlNumber, uint16_t value);
+using SysExChunkCallback           = void (*)(const uint8_t * array, uint16_t size, uint8_t position);
 
 
 
@@ -161,15 +205,111 @@ enum MidiControlChangeNumber: uint8_t
 };
 
 
-/*MIDI Channel Message parameter*/
+/**************************************************************************************
+Status byte decoding: each of the 256 byte values maps to a 16-bit entry,
+the MidiType in the low byte(InvalidType for data bytes and undefined status)
+and the following flags in the high byte.
+**************************************************************************************/
+#define     MIDI_STATUS_LENGTH      (0x03) // Number of data bytes(0 to 2, SysEx: 0)
+#define     MIDI_STATUS_CHANNEL     (0x04) // Channel message
+#define     MIDI_STATUS_RUNNING     (0x08) // Can be sent with running status
+#define     MIDI_STATUS_REALTIME    (0x10) // Single byte, can be interleaved in any message
+#define     MIDI_STATUS_SYSEX       (0x20) // System Exclusive start/end
+
+constexpr uint16_t midiSystemEntry(uint8_t status)
+{
+    return (status == SystemExclusiveStart || status == SystemExclusiveEnd) ? uint16_t(status | (MIDI_STATUS_SYSEX << 8)) :
+           (status == TimeCodeQuarterFrame || status == SongSelect)        ? uint16_t(status | (1 << 8)) :
+           (status == SongPosition)                                        ? uint16_t(status | (2 << 8)) :
+           (status == TuneRequest)                                         ? uint16_t(status) :
+           (status == Undefined_F4 || status == Undefined_F5)              ? uint16_t(InvalidType) :
+           (status == Undefined_F9 || status == Undefined_FD)              ? uint16_t(InvalidType | (MIDI_STATUS_REALTIME << 8)) :
+                                                                             uint16_t(status | (MIDI_STATUS_REALTIME << 8));
+}
+
+constexpr uint16_t midiStatusEntry(uint8_t status)
+{
+    return (status < 0x80) ? uint16_t(InvalidType) :
+           (status < 0xf0) ? uint16_t((status & 0xf0) | ((((status & 0xf0) == ProgramChange || (status & 0xf0) == AfterTouchChannel) ? 1 : 2)
+                                                         | MIDI_STATUS_CHANNEL | MIDI_STATUS_RUNNING) << 8) :
+                             midiSystemEntry(status);
+}
+
+/*Dense index of a type(or status byte) in the type mask:
+  NoteOff..PitchBend -> 0..6, SystemExclusive..SystemReset -> 7..22*/
+constexpr uint8_t midiTypeIndex(uint8_t status)
+{
+    return (status < 0xf0) ? uint8_t((status >> 4) - 8) : uint8_t((status & 0x0f) + 7);
+}
+
+#define     MIDI_TYPE_BIT(type)     (1UL << midiTypeIndex(type)) // Bit of a MidiType in the type mask
+#define     MIDI_TYPE_COUNT         (23) // Number of type indexes(dispatch table entries)
+#define     MIDI_TYPE_MASK_ALL      (0x7fffffUL) // Type mask: every type accepted
+#define     MIDI_CHANNEL_MASK_ALL   (0xffff) // Channel mask: bit 0 is channel 1 ... bit 15 is channel 16
+
+/*Role of each controller number in the parameter decoder(MidiParameterDecoder)*/
+#define     MIDI_CC_PLAIN           (0)  // Not decoded
+#define     MIDI_CC_MSB             (1)  // MSB of a 14-bit controller(0 to 31)
+#define     MIDI_CC_LSB             (2)  // LSB of a 14-bit controller(32 to 63)
+#define     MIDI_CC_DATA_MSB        (3)  // Data Entry MSB(6)
+#define     MIDI_CC_DATA_LSB        (4)  // Data Entry LSB(38)
+#define     MIDI_CC_INCREMENT       (5)  // Data Increment(96)
+#define     MIDI_CC_DECREMENT       (6)  // Data Decrement(97)
+#define     MIDI_CC_NRPN_LSB        (7)  // 98
+#define     MIDI_CC_NRPN_MSB        (8)  // 99
+#define     MIDI_CC_RPN_LSB         (9)  // 100
+#define     MIDI_CC_RPN_MSB         (10) // 101
+
+constexpr uint8_t midiControllerClass(uint8_t controlNumber)
+{
+    return (controlNumber == 6)   ? MIDI_CC_DATA_MSB :
+           (controlNumber == 38)  ? MIDI_CC_DATA_LSB :
+           (controlNumber < 32)   ? MIDI_CC_MSB :
+           (controlNumber < 64)   ? MIDI_CC_LSB :
+           (controlNumber >= 96 && controlNumber <= 101) ? uint8_t(controlNumber - 96 + MIDI_CC_INCREMENT) :
+                                    MIDI_CC_PLAIN;
+}
+
+/*Events of the parameter decoder*/
+#define     MIDI_PARAMETER_NONE     (0)
+#define     MIDI_PARAMETER_RPN      (1)  // Registered Parameter Number value
+#define     MIDI_PARAMETER_NRPN     (2)  // Non-Registered Parameter Number value
+#define     MIDI_PARAMETER_CC14     (3)  // 14-bit controller value
+
+#ifndef PROGMEM
+#define     PROGMEM
+#define     pgm_read_word(address)  (*(const uint16_t *)(address))
+#define     pgm_read_byte(address)  (*(const uint8_t *)(address))
+#endif
+
+extern const uint16_t sMidiStatusTable[256] PROGMEM;
+
+/*Compact MIDI message without SysEx payload(used by the receive ring)*/
+struct MidiPacket{
+    MidiType type;          // MIDI type
+    uint8_t channel;       // MIDI channel
+    uint8_t data1;         // MIDI data
+    uint8_t data2;         // MIDI data
+};
+
+/*Channel message to send with sendEvents()*/
+struct MidiEvent{
+    MidiType type;          // NoteOff to PitchBend
+    uint8_t channel;       // 1 to 16
+    uint8_t data1;         // MIDI data
+    uint8_t data2;         // MIDI data(unused by ProgramChange and AfterTouchChannel)
+};
+
+/*MIDI Channel Message parameter(the SysEx payload is kept apart, see MidiSysEx)*/
 struct MidiMessage{
     uint8_t channel;       // MIDI channel
     MidiType type;          // MIDI type
-    uint8_t data1;         // MIDI data
-    uint8_t data2;         // MIDI type
+    uint8_t data1;         // MIDI data(SysEx: size LSB)
+    uint8_t data2;         // MIDI type(SysEx: size MSB)
     bool valid;         // Identifies whether a MIDI message is valid
-   // uint8_t length;
-    uint8_t sysexArray[SYS_EX_MAXSIZE];  //System Exclusive dedicated byte array
+    // Deprecated: the SysEx payload(getSysExSize() bytes) is not in the message any more,
+    // this points to the SysEx buffer of the interface. Use getSysEx() or the SysEx callback
+    const uint8_t *sysexArray __attribute__((deprecated));
     static const bool  Use1ByteParsing = true;
 
     unsigned getSysExSize() const
@@ -179,6 +319,20 @@ struct MidiMessage{
     }
 };
 
+/*Receive-to-dispatch delay of the timestamped messages(clock units, us by default)*/
+struct MidiDelayStats{
+    uint32_t minimum;
+    uint32_t maximum;
+    uint32_t mean;
+    uint32_t count;        // Number of measured messages
+};
+
+/*Handle on the System Exclusive payload of the last received SysEx message*/
+struct MidiSysEx{
+    const uint8_t *array;  // SysEx bytes(0xF0 ... 0xF7)
+    uint16_t size;         // Number of bytes
+};
+
 
 #endif
 
@@ -0,0 +1,778 @@
+/*************************************************************************
+File:       	  BM_MIDIFilePlayer.cpp
+Author:          BESTMODULES
+Description:    Standard MIDI File player
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； Arduino IDE : v1.8.19
+
+**************************************************************************/
+#include "BM_MIDIFilePlayer.h"
+
+//Controllers chased by seek(), the Bank Select MSB and LSB first(sent before the program)
+static const uint8_t sMidiChasedControllers[MIDI_FILE_CHASE_SIZE] PROGMEM =
+{
+    BankSelect, BankSelect + 32, ModulationWheel, ChannelVolume, Pan, ExpressionController,
+    Sustain, Effects1, Effects3
+};
+
+/************************************************************************* 
+Description:    Constructor
+parameter:
+    Input:          output : the interface the events are sent to
+    Output:         
+Return:         
+Others:         
+*************************************************************************/
+MidiFilePlayer::MidiFilePlayer(MidiInterfaceCore *output)
+{
+    _mOutput = output;
+    _mSource = nullptr;
+    _mRead = nullptr;
+    _mData = nullptr;
+    _mSize = 0;
+    _mFormat = 0;
+    _mTrackCount = 0;
+    _mDivision = 0;
+    _mSmpte = false;
+    _mHeapSize = 0;
+    _mTempo = MIDI_FILE_DEFAULT_TEMPO;
+    _mAnchorTick = 0;
+    _mAnchorTime = 0;
+    _mTick = 0;
+    _mPlaying = false;
+    _mStartTime = 0;
+    _mPauseTime = 0;
+    _mMaxLateness = 0;
+    _mIndexSize = 0;
+    _mIndexCount = 0;
+    _mIndexInterval = 0;
+}
+/************************************************************************* 
+Description:    Open a MIDI file read through a read function
+parameter:
+    Input:      source：the file object given to the read function(File...)
+                readFunction：reads bytes of the file at a given position
+    Output:         
+Return:         true：the file is ready to play(stopped at the start)
+                false：not a type 0 or 1 MIDI file, or more than MIDI_FILE_TRACKS tracks
+Others:         Only MIDI_FILE_BUFFER_SIZE bytes per track are kept in RAM,
+                the tracks are read where they are in the file. The seek index
+                keeps MIDI_FILE_MARKS / tracks checkpoints(MIDI_FILE_INDEX_SIZE at most).
+**************************************************************************/
+bool MidiFilePlayer::begin(void *source, MidiFileReadFunction readFunction)
+{
+    _mSource = source;
+    _mRead = readFunction;
+    _mPlaying = false;
+    _mHeapSize = 0;
+    _mIndexCount = 0;
+    if (!readHeader())
+    {
+        _mTrackCount = 0;
+        return false;
+    }
+    _mIndexSize = MIDI_FILE_MARKS / _mTrackCount;
+    if (_mIndexSize > MIDI_FILE_INDEX_SIZE)
+    {
+        _mIndexSize = MIDI_FILE_INDEX_SIZE;
+    }
+    _mIndexInterval = uint32_t(_mDivision) * 16;//4 bars of 4/4, doubled each time the index is full
+    restore(nullptr);
+    return true;
+}
+/************************************************************************* 
+Description:    Open a MIDI file held in memory
+parameter:
+    Input:      data：the file
+                size：the size of the file
+    Output:         
+Return:         true：the file is ready to play
+                false：not a type 0 or 1 MIDI file
+Others:         The data must be readable with a pointer(RAM, or flash on
+                the boards where flash is in the address space)
+**************************************************************************/
+bool MidiFilePlayer::begin(const uint8_t *data, uint32_t size)
+{
+    _mData = data;
+    _mSize = size;
+    return begin(this, &MidiFilePlayer::readMemory);
+}
+/************************************************************************* 
+Description:    Start or resume the playback
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Call update() as often as possible
+**************************************************************************/
+void MidiFilePlayer::play(void)
+{
+    _mStartTime = micros() - _mPauseTime;
+    _mPlaying = true;
+}
+/************************************************************************* 
+Description:    Stop the playback where it is(play() resumes it)
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         The notes held are turned off if the output has a note
+                tracker(see setNoteTracker())
+**************************************************************************/
+void MidiFilePlayer::stop(void)
+{
+    if (_mPlaying)
+    {
+        _mPauseTime = micros() - _mStartTime;
+        _mPlaying = false;
+    }
+    _mOutput->panic();
+}
+/************************************************************************* 
+Description:    Send the events whose time has come
+parameter:
+    Input:          
+    Output:         
+Return:         true：playing；false：stopped or end of the song
+Others:         The song time is counted in us with micros(): songs up to 71 minutes
+**************************************************************************/
+bool MidiFilePlayer::update(void)
+{
+    if (!_mPlaying)
+    {
+        return false;
+    }
+    const uint32_t songTime = micros() - _mStartTime;
+    while (_mHeapSize != 0)
+    {
+        const uint32_t eventTime = tickTime(_mTracks[_mHeap[0]].nextTick);
+        if (int32_t(songTime - eventTime) < 0)
+        {
+            return true;
+        }
+        if (songTime - eventTime > _mMaxLateness)
+        {
+            _mMaxLateness = songTime - eventTime;
+        }
+        playEvent(nullptr);
+    }
+    _mPlaying = false;
+    _mPauseTime = songTime;
+    return false;
+}
+/************************************************************************* 
+Description:    Move the playback to a tick
+parameter:
+    Input:      tick：the tick(of the file time division)
+    Output:         
+Return:         false：no file
+Others:         The song restarts from the last checkpoint before the tick and
+                the events up to the tick are read without being sent(the tempo
+                events are followed). Checkpoints are recorded on the way, the
+                next seek around the same place reads much less.
+                The last Program Change, Pitch Bend and chased controllers of each
+                channel read on the way are sent once at the tick(bank first);
+                the parameter number and Data Entry controllers are sent as read.
+                The values set before the checkpoint restored are not sent again.
+                The chase uses 192 bytes of stack during the seek.
+**************************************************************************/
+bool MidiFilePlayer::seek(uint32_t tick)
+{
+    if (_mTrackCount == 0)
+    {
+        return false;
+    }
+    _mOutput->panic();
+    const MidiFileCheckpoint *checkpoint = nullptr;
+    for (uint8_t i = 0; i < _mIndexCount && _mIndex[i].tick <= tick; i++)
+    {
+        checkpoint = &_mIndex[i];
+    }
+    if (_mTick > tick || (checkpoint != nullptr && checkpoint->tick > _mTick))
+    {
+        restore(checkpoint);//Else going on from the current position reads less
+    }
+    MidiFileChase chase;
+    memset(chase.program, MIDI_CACHE_UNKNOWN, sizeof(chase.program));
+    memset(chase.pitchBend, 0xff, sizeof(chase.pitchBend));//MIDI_CACHE_UNKNOWN_14BIT
+    memset(chase.control, MIDI_CACHE_UNKNOWN, sizeof(chase.control));
+    while (_mHeapSize != 0 && _mTracks[_mHeap[0]].nextTick < tick)
+    {
+        playEvent(&chase);
+    }
+    sendChase(chase);
+    _mTick = tick;
+    _mPauseTime = tickTime(tick);
+    _mStartTime = micros() - _mPauseTime;
+    return true;
+}
+/************************************************************************* 
+Description:    Move the playback to a Song Position Pointer
+parameter:
+    Input:      beats：MIDI beats(sixteenth notes) from the start of the song
+    Output:         
+Return:         false：no file, or SMPTE time division
+Others:         Connect it to setHandleSongPosition() to follow a sequencer
+**************************************************************************/
+bool MidiFilePlayer::seekSongPosition(uint16_t beats)
+{
+    if (_mSmpte)
+    {
+        return false;
+    }
+    return seek(uint32_t(beats) * _mDivision / 4);
+}
+/************************************************************************* 
+Description:    Get the song time
+parameter:
+    Input:          
+    Output:         
+Return:         us from the start of the song
+Others:         
+**************************************************************************/
+uint32_t MidiFilePlayer::getSongTime(void)
+{
+    return _mPlaying ? uint32_t(micros() - _mStartTime) : _mPauseTime;
+}
+/************************************************************************* 
+Description:    Get the time before the next event
+parameter:
+    Input:          
+    Output:         
+Return:         us before the next event is due(0：due now), 0xffffffff：no more event
+Others:         The sketch can sleep or do other work that long
+**************************************************************************/
+uint32_t MidiFilePlayer::getTimeToNextEvent(void)
+{
+    if (_mHeapSize == 0)
+    {
+        return 0xffffffff;
+    }
+    const int32_t wait = int32_t(tickTime(_mTracks[_mHeap[0]].nextTick) - getSongTime());
+    return (wait > 0) ? uint32_t(wait) : 0;
+}
+/************************************************************************* 
+Description:    Read function of the files in memory
+parameter:
+    Input:      source：the player
+                position：the position in the file
+                array：the bytes read
+                length：the number of bytes to read
+    Output:         
+Return:         the number of bytes read
+Others:         
+**************************************************************************/
+size_t MidiFilePlayer::readMemory(void *source, uint32_t position, uint8_t *array, size_t length)
+{
+    const MidiFilePlayer *player = static_cast<const MidiFilePlayer *>(source);
+    if (position >= player->_mSize)
+    {
+        return 0;
+    }
+    if (length > player->_mSize - position)
+    {
+        length = player->_mSize - position;
+    }
+    memcpy(array, player->_mData + position, length);
+    return length;
+}
+/************************************************************************* 
+Description:    Read the header chunk and find the track chunks
+parameter:
+    Input:          
+    Output:         
+Return:         true：type 0 or 1 file with 1 to MIDI_FILE_TRACKS tracks
+Others:         Other chunks are skipped
+**************************************************************************/
+bool MidiFilePlayer::readHeader(void)
+{
+    uint8_t chunk[14];
+    if (_mRead(_mSource, 0, chunk, 14) != 14 || memcmp(chunk, "MThd", 4) != 0)
+    {
+        return false;
+    }
+    const uint32_t headerLength = (uint32_t(chunk[4]) << 24) | (uint32_t(chunk[5]) << 16) | (uint32_t(chunk[6]) << 8) | chunk[7];
+    const uint16_t format = uint16_t((chunk[8] << 8) | chunk[9]);
+    const uint16_t tracks = uint16_t((chunk[10] << 8) | chunk[11]);
+    if (headerLength < 6 || format > 1 || tracks == 0 || tracks > MIDI_FILE_TRACKS)
+    {
+        return false;
+    }
+    _mFormat = uint8_t(format);
+    if (chunk[12] & 0x80)
+    {
+        //SMPTE:frames per second(two's complement) and ticks per frame
+        const uint8_t fps = uint8_t(-int8_t(chunk[12]));
+        _mSmpte = true;
+        _mDivision = uint16_t((fps == 29 ? 30 : fps) * chunk[13]);
+        _mTempo = (fps == 29) ? 1001000 : 1000000;//us per _mDivision ticks(29.97 fps drop frame)
+    }
+    else
+    {
+        _mSmpte = false;
+        _mDivision = uint16_t((chunk[12] << 8) | chunk[13]);
+        if (_mDivision == 0)
+        {
+            return false;
+        }
+    }
+
+    uint32_t position = 8 + headerLength;
+    _mTrackCount = 0;
+    while (_mTrackCount < tracks && _mRead(_mSource, position, chunk, 8) == 8)
+    {
+        const uint32_t length = (uint32_t(chunk[4]) << 24) | (uint32_t(chunk[5]) << 16) | (uint32_t(chunk[6]) << 8) | chunk[7];
+        if (memcmp(chunk, "MTrk", 4) == 0)
+        {
+            _mTracks[_mTrackCount].start = position + 8;
+            _mTracks[_mTrackCount].end = position + 8 + length;
+            _mTrackCount++;
+        }
+        position += 8 + length;
+    }
+    return _mTrackCount != 0;
+}
+/************************************************************************* 
+Description:    Read the next byte of a track
+parameter:
+    Input:      track：the track
+    Output:         
+Return:         the byte, 0 after the end of the track
+Others:         The buffer is refilled from the source when empty
+**************************************************************************/
+uint8_t MidiFilePlayer::readByte(MidiFileTrack &track)
+{
+    if (track.index >= track.length)
+    {
+        uint32_t length = track.end - track.position;
+        if (track.position >= track.end)
+        {
+            return 0;
+        }
+        if (length > MIDI_FILE_BUFFER_SIZE)
+        {
+            length = MIDI_FILE_BUFFER_SIZE;
+        }
+        track.length = uint8_t(_mRead(_mSource, track.position, track.buffer, length));
+        track.index = 0;
+        if (track.length == 0)
+        {
+            track.position = track.end;//Truncated file
+            return 0;
+        }
+        track.position += track.length;
+    }
+    return track.buffer[track.index++];
+}
+/************************************************************************* 
+Description:    Read a variable-length quantity(delta-time, length)
+parameter:
+    Input:      track：the track
+    Output:         
+Return:         the value(4 bytes at most)
+Others:         
+**************************************************************************/
+uint32_t MidiFilePlayer::readVariable(MidiFileTrack &track)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        const uint8_t data = readByte(track);
+        value = (value << 7) | (data & 0x7f);
+        if (!(data & 0x80))
+        {
+            break;
+        }
+    }
+    return value;
+}
+/************************************************************************* 
+Description:    Get the position of the next byte of a track
+parameter:
+    Input:      track：the track
+    Output:         
+Return:         the position in the file
+Others:         
+**************************************************************************/
+uint32_t MidiFilePlayer::readPosition(const MidiFileTrack &track)
+{
+    return track.position - (track.length - track.index);
+}
+/************************************************************************* 
+Description:    Move the read position of a track
+parameter:
+    Input:      track：the track
+                position：the position in the file
+    Output:         
+Return:         
+Others:         A move inside the buffer does not read the source again
+**************************************************************************/
+void MidiFilePlayer::moveTo(MidiFileTrack &track, uint32_t position)
+{
+    const uint32_t bufferStart = track.position - track.length;
+    if (position >= bufferStart && position < track.position)
+    {
+        track.index = uint8_t(position - bufferStart);
+        return;
+    }
+    track.position = (position < track.end) ? position : track.end;
+    track.length = 0;
+    track.index = 0;
+}
+/************************************************************************* 
+Description:    Read the delta-time of the next event of a track and queue it
+parameter:
+    Input:      trackIndex：the track
+    Output:         
+Return:         
+Others:         A track at its end is not queued
+**************************************************************************/
+void MidiFilePlayer::loadEvent(uint8_t trackIndex)
+{
+    MidiFileTrack &track = _mTracks[trackIndex];
+    track.eventPosition = readPosition(track);
+    if (track.eventPosition >= track.end)
+    {
+        return;
+    }
+    track.nextTick = track.prevTick + readVariable(track);
+    heapPush(trackIndex);
+}
+/************************************************************************* 
+Description:    Play the earliest event, then queue the next event of its track
+parameter:
+    Input:      chase：nullptr：send the MIDI events；else skip them into the chase(seek)
+    Output:         
+Return:         
+Others:         Tempo events are followed in both cases
+**************************************************************************/
+void MidiFilePlayer::playEvent(MidiFileChase *chase)
+{
+    if (_mTracks[_mHeap[0]].nextTick >= _mIndexInterval * (_mIndexCount + 1)
+    &&  (_mIndexCount == 0 || _mTracks[_mHeap[0]].nextTick > _mIndex[_mIndexCount - 1].tick))
+    {
+        recordCheckpoint();
+    }
+    const uint8_t trackIndex = heapPop();
+    MidiFileTrack &track = _mTracks[trackIndex];
+    track.prevTick = track.nextTick;
+    _mTick = track.nextTick;
+
+    uint8_t status = readByte(track);
+    uint8_t data1 = 0;
+    if (status < 0x80)
+    {
+        data1 = status;//Running status
+        status = track.status;
+        if (status == 0)
+        {
+            track.eventPosition = track.end;//Corrupted track
+            return;
+        }
+    }
+    else
+    {
+        track.status = 0;
+    }
+
+    if (status < SystemExclusiveStart)
+    {
+        const uint8_t length = (pgm_read_word(&sMidiStatusTable[status]) >> 8) & MIDI_STATUS_LENGTH;
+        if (track.status != status)
+        {
+            data1 = readByte(track);
+            track.status = status;
+        }
+        const uint8_t data2 = (length == 2) ? readByte(track) : 0;
+        if (chase == nullptr)
+        {
+            _mOutput->send(MidiType(status & 0xf0), data1, data2, (status & 0x0f) + 1);
+        }
+        else
+        {
+            chaseEvent(*chase, status, data1, data2);
+        }
+    }
+    else if (status == SystemExclusiveStart || status == SystemExclusiveEnd)
+    {
+        const uint32_t length = readVariable(track);
+        if (chase == nullptr)
+        {
+            sendData(track, length, status == SystemExclusiveStart);
+        }
+        else
+        {
+            moveTo(track, readPosition(track) + length);
+        }
+    }
+    else if (status == 0xff)//Meta event
+    {
+        const uint8_t type = readByte(track);
+        const uint32_t length = readVariable(track);
+        const uint32_t next = readPosition(track) + length;
+        if (type == 0x2f)
+        {
+            return;//End of Track
+        }
+        if (type == 0x51 && length == 3 && !_mSmpte)
+        {
+            uint32_t tempo = readByte(track);
+            tempo = (tempo << 8) | readByte(track);
+            tempo = (tempo << 8) | readByte(track);
+            _mAnchorTime = tickTime(_mTick);
+            _mAnchorTick = _mTick;
+            _mTempo = tempo;
+        }
+        moveTo(track, next);
+    }
+    else
+    {
+        return;//Not an SMF event: the track cannot be read further
+    }
+    loadEvent(trackIndex);
+}
+/************************************************************************* 
+Description:    Keep the value of a channel event skipped by seek()
+parameter:
+    Input:      chase：the chased values
+                status：the status byte of the event
+                data1, data2：its data bytes
+    Output:         
+Return:         
+Others:         The notes and the pressures are not chased, the parameter number
+                and Data Entry controllers are sent in their order(their values
+                depend on the sequence). The other controllers are dropped.
+**************************************************************************/
+void MidiFilePlayer::chaseEvent(MidiFileChase &chase, uint8_t status, uint8_t data1, uint8_t data2)
+{
+    const uint8_t index = status & 0x0f;
+    switch (status & 0xf0)
+    {
+        case ProgramChange:
+            chase.program[index] = data1;
+            break;
+        case PitchBend:
+            chase.pitchBend[index] = uint16_t(data1 | (data2 << 7));
+            break;
+        case ControlChange:
+            for (uint8_t i = 0; i < MIDI_FILE_CHASE_SIZE; i++)
+            {
+                if (pgm_read_byte(&sMidiChasedControllers[i]) == data1)
+                {
+                    chase.control[index][i] = data2;
+                    return;
+                }
+            }
+            if (data1 < AllSoundOff && !MidiControllerCache::isCached(data1))
+            {
+                _mOutput->sendControlChange(data1, data2, index + 1);
+            }
+            break;
+        default:
+            break;
+    }
+}
+/************************************************************************* 
+Description:    Send the values chased by seek()
+parameter:
+    Input:      chase：the chased values
+    Output:         
+Return:         
+Others:         Per channel: Bank Select, Program Change, the other chased
+                controllers, Pitch Bend
+**************************************************************************/
+void MidiFilePlayer::sendChase(const MidiFileChase &chase)
+{
+    for (uint8_t index = 0; index < 16; index++)
+    {
+        for (uint8_t i = 0; i < MIDI_FILE_CHASE_SIZE; i++)
+        {
+            if (i == 2 && chase.program[index] != MIDI_CACHE_UNKNOWN)
+            {
+                _mOutput->sendProgramChange(chase.program[index], index + 1);//After the bank
+            }
+            if (chase.control[index][i] != MIDI_CACHE_UNKNOWN)
+            {
+                _mOutput->sendControlChange(pgm_read_byte(&sMidiChasedControllers[i]), chase.control[index][i], index + 1);
+            }
+        }
+        if (chase.pitchBend[index] != MIDI_CACHE_UNKNOWN_14BIT)
+        {
+            _mOutput->send(PitchBend, chase.pitchBend[index] & 0x7f, chase.pitchBend[index] >> 7, index + 1);
+        }
+    }
+}
+/************************************************************************* 
+Description:    Send the bytes of a SysEx event(or of an escape event)
+parameter:
+    Input:      track：the track
+                length：the number of bytes in the file
+                sysExStart：true：0xF0 event, the 0xF0 is sent first
+    Output:         
+Return:         
+Others:         Sent in MIDI_FILE_BUFFER_SIZE byte blocks, any length
+**************************************************************************/
+void MidiFilePlayer::sendData(MidiFileTrack &track, uint32_t length, bool sysExStart)
+{
+    uint8_t block[MIDI_FILE_BUFFER_SIZE];
+    uint8_t count = 0;
+    if (sysExStart)
+    {
+        block[count++] = SystemExclusiveStart;
+    }
+    while (length != 0)
+    {
+        block[count++] = readByte(track);
+        length--;
+        if (count == MIDI_FILE_BUFFER_SIZE || length == 0)
+        {
+            _mOutput->sendSysEx(count, block, true);
+            count = 0;
+        }
+    }
+    if (count != 0)
+    {
+        _mOutput->sendSysEx(count, block, true);
+    }
+}
+/************************************************************************* 
+Description:    Put the song back at a checkpoint
+parameter:
+    Input:      checkpoint：the checkpoint, nullptr：start of the song
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiFilePlayer::restore(const MidiFileCheckpoint *checkpoint)
+{
+    const MidiFileMark *marks = (checkpoint != nullptr) ? &_mMarks[(checkpoint - _mIndex) * _mTrackCount] : nullptr;
+    _mHeapSize = 0;
+    if (checkpoint != nullptr)
+    {
+        _mTick = checkpoint->tick;
+        _mAnchorTick = checkpoint->anchorTick;//Not re-anchored: the times after a seek round as in playback
+        _mAnchorTime = checkpoint->anchorTime;
+        _mTempo = checkpoint->tempo;
+    }
+    else
+    {
+        _mTick = 0;
+        _mAnchorTick = 0;
+        _mAnchorTime = 0;
+        if (!_mSmpte)
+        {
+            _mTempo = MIDI_FILE_DEFAULT_TEMPO;
+        }
+    }
+    for (uint8_t i = 0; i < _mTrackCount; i++)
+    {
+        MidiFileTrack &track = _mTracks[i];
+        track.length = 0;
+        track.index = 0;
+        track.position = (marks != nullptr) ? marks[i].eventPosition : track.start;
+        track.prevTick = (marks != nullptr) ? marks[i].prevTick : 0;
+        track.status = (marks != nullptr) ? marks[i].status : 0;
+        loadEvent(i);
+    }
+}
+/************************************************************************* 
+Description:    Record the song state before the earliest event as a checkpoint
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         When the index is full every other checkpoint is removed and
+                the interval doubles, so the index covers the song read so far
+**************************************************************************/
+void MidiFilePlayer::recordCheckpoint(void)
+{
+    if (_mIndexCount == _mIndexSize)
+    {
+        for (uint8_t i = 0; i < _mIndexSize / 2; i++)
+        {
+            _mIndex[i] = _mIndex[2 * i + 1];//Keep the multiples of the doubled interval
+            memcpy(&_mMarks[i * _mTrackCount], &_mMarks[(2 * i + 1) * _mTrackCount], _mTrackCount * sizeof(MidiFileMark));
+        }
+        _mIndexCount = _mIndexSize / 2;
+        _mIndexInterval *= 2;
+        if (_mTracks[_mHeap[0]].nextTick < _mIndexInterval * (_mIndexCount + 1))
+        {
+            return;
+        }
+    }
+    MidiFileMark *marks = &_mMarks[_mIndexCount * _mTrackCount];
+    MidiFileCheckpoint &checkpoint = _mIndex[_mIndexCount++];
+    checkpoint.tick = _mTracks[_mHeap[0]].nextTick;
+    checkpoint.anchorTick = _mAnchorTick;
+    checkpoint.anchorTime = _mAnchorTime;
+    checkpoint.tempo = _mTempo;
+    for (uint8_t i = 0; i < _mTrackCount; i++)
+    {
+        marks[i].eventPosition = _mTracks[i].eventPosition;
+        marks[i].prevTick = _mTracks[i].prevTick;
+        marks[i].status = _mTracks[i].status;
+    }
+}
+/************************************************************************* 
+Description:    Get the time of a tick after the last tempo change
+parameter:
+    Input:      tick：the tick
+    Output:         
+Return:         us from the start of the song
+Others:         
+**************************************************************************/
+uint32_t MidiFilePlayer::tickTime(uint32_t tick)
+{
+    return _mAnchorTime + uint32_t(uint64_t(tick - _mAnchorTick) * _mTempo / _mDivision);
+}
+/************************************************************************* 
+Description:    Heap of the tracks ordered by their next event(ties:track order)
+parameter:
+    Input:      trackIndex：the track to queue
+    Output:         
+Return:         heapPop()：the track with the earliest event
+Others:         
+**************************************************************************/
+bool MidiFilePlayer::heapLess(uint8_t a, uint8_t b)
+{
+    return (_mTracks[a].nextTick != _mTracks[b].nextTick) ? (_mTracks[a].nextTick < _mTracks[b].nextTick) : (a < b);
+}
+void MidiFilePlayer::heapPush(uint8_t trackIndex)
+{
+    uint8_t i = _mHeapSize++;
+    while (i > 0 && heapLess(trackIndex, _mHeap[(i - 1) / 2]))
+    {
+        _mHeap[i] = _mHeap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    _mHeap[i] = trackIndex;
+}
+uint8_t MidiFilePlayer::heapPop(void)
+{
+    const uint8_t top = _mHeap[0];
+    const uint8_t last = _mHeap[--_mHeapSize];
+    uint8_t i = 0;
+    while (true)
+    {
+        uint8_t child = 2 * i + 1;
+        if (child >= _mHeapSize)
+        {
+            break;
+        }
+        if (child + 1 < _mHeapSize && heapLess(_mHeap[child + 1], _mHeap[child]))
+        {
+            child++;
+        }
+        if (!heapLess(_mHeap[child], last))
+        {
+            break;
+        }
+        _mHeap[i] = _mHeap[child];
+        i = child;
+    }
+    if (_mHeapSize != 0)
+    {
+        _mHeap[i] = last;
+    }
+    return top;
+}
@@ -0,0 +1,127 @@
+/***************************************************************************
+File:       		BM_MIDIFilePlayer.h
+Author:           BESTMODULE
+Description:      Standard MIDI File(type 0 and 1) player: the events are
+                  streamed from any byte source(SD file, flash, RAM) and sent
+                  through a MIDI interface at their time
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；Arduino IDE : v1.8.19
+
+****************************************************************************/
+#ifndef _BM_MIDI_FILE_PLAYER_H
+#define _BM_MIDI_FILE_PLAYER_H
+
+#include "BMV51M001.h"
+
+//Reads length bytes of the file from the given position, returns the number of bytes read
+using MidiFileReadFunction = size_t (*)(void *source, uint32_t position, uint8_t *array, size_t length);
+
+/*Read state of a track*/
+struct MidiFileTrack{
+    uint32_t start;         // First event of the track
+    uint32_t end;           // End of the track chunk
+    uint32_t position;      // Next byte to read from the source
+    uint32_t eventPosition; // Delta-time of the pending event
+    uint32_t prevTick;      // Tick of the last event read
+    uint32_t nextTick;      // Tick of the pending event
+    uint8_t status;         // Running status, 0:none
+    uint8_t length;         // Bytes in the buffer
+    uint8_t index;          // Next byte of the buffer
+    uint8_t buffer[MIDI_FILE_BUFFER_SIZE];
+};
+
+#if MIDI_FILE_MARKS < 2 * MIDI_FILE_TRACKS
+#error "MIDI_FILE_MARKS must hold 2 checkpoints of MIDI_FILE_TRACKS tracks"
+#endif
+
+/*Seek checkpoint: the song state before the events of a tick, with one mark
+  per track in the mark pool of the player*/
+struct MidiFileMark{
+    uint32_t eventPosition;
+    uint32_t prevTick;
+    uint8_t status;
+};
+struct MidiFileCheckpoint{
+    uint32_t tick;
+    uint32_t anchorTick;    // Tick of the last tempo change
+    uint32_t anchorTime;    // us from the start of the song to anchorTick
+    uint32_t tempo;         // us per quarter note
+};
+
+/*Channel state chased by seek() over the events it skips(on the stack during the seek)*/
+struct MidiFileChase{
+    uint8_t program[16];    // MIDI_CACHE_UNKNOWN:no Program Change skipped
+    uint16_t pitchBend[16]; // MIDI_CACHE_UNKNOWN_14BIT:no Pitch Bend skipped
+    uint8_t control[16][MIDI_FILE_CHASE_SIZE];//values of the chased controllers
+};
+
+/*****************class for playing a Standard MIDI File*******************/
+class MidiFilePlayer
+{
+public:
+    MidiFilePlayer(MidiInterfaceCore *output);
+    bool begin(void *source, MidiFileReadFunction readFunction);
+    bool begin(const uint8_t *data, uint32_t size);
+    void play(void);
+    void stop(void);
+    bool update(void);
+    bool seek(uint32_t tick);
+    bool seekSongPosition(uint16_t beats);
+    bool isPlaying(void) { return _mPlaying; }
+    bool isFinished(void) { return _mHeapSize == 0; }
+    uint32_t getTick(void) { return _mTick; }
+    uint32_t getSongTime(void);
+    uint32_t getTimeToNextEvent(void);
+    uint32_t getTempo(void) { return _mTempo; }
+    uint16_t getDivision(void) { return _mDivision; }
+    uint8_t getFormat(void) { return _mFormat; }
+    uint8_t getTrackCount(void) { return _mTrackCount; }
+    uint32_t getMaxLateness(void) { return _mMaxLateness; }
+
+protected:
+    static size_t readMemory(void *source, uint32_t position, uint8_t *array, size_t length);
+    bool readHeader(void);
+    uint8_t readByte(MidiFileTrack &track);
+    uint32_t readVariable(MidiFileTrack &track);
+    uint32_t readPosition(const MidiFileTrack &track);
+    void moveTo(MidiFileTrack &track, uint32_t position);
+    void loadEvent(uint8_t trackIndex);//read the delta-time of the next event, queue the track
+    void playEvent(MidiFileChase *chase);//play the event at the top of the heap, or skip it into chase(seek)
+    void chaseEvent(MidiFileChase &chase, uint8_t status, uint8_t data1, uint8_t data2);
+    void sendChase(const MidiFileChase &chase);
+    void sendData(MidiFileTrack &track, uint32_t length, bool sysExStart);
+    void restore(const MidiFileCheckpoint *checkpoint);//nullptr:start of the song
+    void recordCheckpoint(void);
+    uint32_t tickTime(uint32_t tick);
+    void heapPush(uint8_t trackIndex);
+    uint8_t heapPop(void);
+    bool heapLess(uint8_t a, uint8_t b);
+
+    MidiInterfaceCore  *_mOutput;
+    void               *_mSource;
+    MidiFileReadFunction _mRead;
+    const uint8_t      *_mData;//begin(data, size):the file in memory
+    uint32_t            _mSize;
+    uint8_t             _mFormat;
+    uint8_t             _mTrackCount;
+    uint16_t            _mDivision;//ticks per quarter note(or per second with SMPTE)
+    bool                _mSmpte;//true:SMPTE time division, tempo events ignored
+    MidiFileTrack       _mTracks[MIDI_FILE_TRACKS];
+    uint8_t             _mHeap[MIDI_FILE_TRACKS];//track indexes, the earliest event on top
+    uint8_t             _mHeapSize;
+    uint32_t            _mTempo;//us per quarter note
+    uint32_t            _mAnchorTick;//last tempo change
+    uint32_t            _mAnchorTime;//us, time of _mAnchorTick
+    uint32_t            _mTick;//tick of the last event played
+    bool                _mPlaying;
+    unsigned long       _mStartTime;//micros() of the song start(playing)
+    uint32_t            _mPauseTime;//us, song time when stopped
+    uint32_t            _mMaxLateness;//us, latest event sent after its time
+    MidiFileCheckpoint  _mIndex[MIDI_FILE_INDEX_SIZE];//seek checkpoints, by tick
+    MidiFileMark        _mMarks[MIDI_FILE_MARKS];//track marks of the checkpoints, _mTrackCount per checkpoint
+    uint8_t             _mIndexSize;//checkpoints the marks hold for the tracks of the file
+    uint8_t             _mIndexCount;
+    uint32_t            _mIndexInterval;//ticks between two checkpoints
+};
+
+#endif
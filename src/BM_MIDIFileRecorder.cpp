@@ -0,0 +1,505 @@
+/*************************************************************************
+File:       	  BM_MIDIFileRecorder.cpp
+Author:          BESTMODULES
+Description:    Standard MIDI File recorder
+History：
+	V1.0.1	 -- initial version； 2023-01-17； Arduino IDE : v1.8.19
+
+**************************************************************************/
+#include "BM_MIDIFileRecorder.h"
+
+#define MIDI_RECORD_HEADER_SIZE     (22)//MThd chunk and MTrk chunk header
+
+/*Time in units of 1/MIDI_RECORD_TIME_UNITS us, so that a tick is a whole number
+  of units(120 bpm, 960 ticks per quarter note: 6 units per us, 3125 per tick)*/
+static constexpr uint32_t recordGcd(uint32_t a, uint32_t b) { return (b == 0) ? a : recordGcd(b, a % b); }
+#define MIDI_RECORD_TIME_UNITS      (MIDI_RECORD_DIVISION / recordGcd(MIDI_FILE_DEFAULT_TEMPO, MIDI_RECORD_DIVISION))
+#define MIDI_RECORD_TICK_UNITS      (MIDI_FILE_DEFAULT_TEMPO / recordGcd(MIDI_FILE_DEFAULT_TEMPO, MIDI_RECORD_DIVISION))
+#define MIDI_RECORD_TICK_SHIFT      (23)
+#define MIDI_RECORD_TICK_FACTOR     ((1UL << MIDI_RECORD_TICK_SHIFT) / MIDI_RECORD_TICK_UNITS)//units to ticks, rounded down
+#define MIDI_RECORD_EARLY           (0x1000000UL)//us, a time up to 16.7s before the last one is earlier, not 71 minutes later
+
+/*************************************************************************
+Description:    Constructor
+parameter:
+    Input:
+    Output:
+Return:
+Others:
+*************************************************************************/
+MidiFileRecorder::MidiFileRecorder()
+{
+    _mSink = nullptr;
+    _mWrite = nullptr;
+    _mRecording = false;
+    _mTypeMask = MIDI_TYPE_MASK_ALL & ~MIDI_TYPE_BIT(ActiveSensing);
+    _mTickTime = 0;
+    _mTick = 0;
+    _mTickRest = 0;
+    _mLastTick = 0;
+    _mRunningStatus = 0;
+    _mSysExOpen = false;
+    _mPosition = 0;
+    _mActive = 0;
+    _mFill = 0;
+    _mPendingLength = 0;
+    _mPendingIndex = 0;
+    memset(&_mStats, 0, sizeof(_mStats));
+}
+/*************************************************************************
+Description:    Start a recording: the file header and the tempo are buffered,
+                tick 0 is now
+parameter:
+    Input:      sink：the file object given to the write function(File...)
+                writeFunction：writes bytes at a given position of the file
+    Output:
+Return:         false：a recording is running, call end() first
+Others:         Attach the recorder to the MIDI interface with setRecorder()
+**************************************************************************/
+bool MidiFileRecorder::begin(void *sink, MidiFileWriteFunction writeFunction)
+{
+    if (_mRecording || writeFunction == nullptr)
+    {
+        return false;
+    }
+    _mSink = sink;
+    _mWrite = writeFunction;
+    _mPosition = 0;
+    _mActive = 0;
+    _mFill = 0;
+    _mPendingLength = 0;
+    _mPendingIndex = 0;
+    memset(&_mStats, 0, sizeof(_mStats));
+    _mRunningStatus = 0;
+    _mSysExOpen = false;
+    _mLastTick = 0;
+    _mTickTime = micros();
+    _mTick = 0;
+    _mTickRest = 0;
+
+    putHeader(0);//The track length is written by end()
+    put(0x00);
+    put(0xff);
+    put(0x51);
+    put(3);
+    put(uint8_t(MIDI_FILE_DEFAULT_TEMPO >> 16));
+    put(uint8_t(MIDI_FILE_DEFAULT_TEMPO >> 8));
+    put(uint8_t(MIDI_FILE_DEFAULT_TEMPO));
+    _mRecording = true;
+    return true;
+}
+/*************************************************************************
+Description:    End the recording: End of Track, then every buffered byte and
+                the track length are written
+parameter:
+    Input:
+    Output:
+Return:         true：the file is complete
+                false：not recording, or the sink did not take every byte
+Others:         Waits for the sink. The track length is written at position 18,
+                a sink that cannot move back(Print...) must skip that write.
+**************************************************************************/
+bool MidiFileRecorder::end(void)
+{
+    if (!_mRecording)
+    {
+        return false;
+    }
+    _mRecording = false;
+    const uint32_t tick = timeTick(micros());
+    if (!reserve(variableLength(tick - _mLastTick) + 3) && !flush())
+    {
+        return false;
+    }
+    putVariable(tick - _mLastTick);
+    put(0xff);
+    put(0x2f);
+    put(0);
+    if (!flush())
+    {
+        return false;//The sink is full or failed
+    }
+
+    const uint32_t trackLength = _mPosition - MIDI_RECORD_HEADER_SIZE;
+    const uint8_t length[4] = {uint8_t(trackLength >> 24), uint8_t(trackLength >> 16), uint8_t(trackLength >> 8), uint8_t(trackLength)};
+    _mWrite(_mSink, MIDI_RECORD_HEADER_SIZE - 4, length, 4);
+    return true;
+}
+/*************************************************************************
+Description:    Write the full buffer to the sink
+parameter:
+    Input:
+    Output:
+Return:         true：bytes are still waiting for the sink
+Others:         Call it from loop(): the write time of the sink is spent here.
+                A sink may take part of the bytes, the rest is written next time.
+**************************************************************************/
+bool MidiFileRecorder::update(void)
+{
+    if (_mPendingLength == 0 && _mFill == MIDI_RECORD_BUFFER_SIZE)
+    {
+        swap();
+    }
+    if (_mPendingLength == 0)
+    {
+        return false;
+    }
+    const uint8_t *array = _mBuffer[_mActive ^ 1] + _mPendingIndex;
+    const size_t written = _mWrite(_mSink, _mPosition, array, _mPendingLength - _mPendingIndex);
+    _mPosition += written;
+    _mStats.bytesWritten += written;
+    _mPendingIndex += written;
+    if (_mPendingIndex >= _mPendingLength)
+    {
+        _mPendingLength = 0;
+        _mPendingIndex = 0;
+    }
+    return _mPendingLength != 0;
+}
+/*************************************************************************
+Description:    Write every buffered byte to the sink
+parameter:
+    Input:
+    Output:
+Return:         true：the buffers are empty
+                false：the sink stopped taking bytes
+Others:         Waits for the sink
+**************************************************************************/
+bool MidiFileRecorder::flush(void)
+{
+    while (true)
+    {
+        if (_mPendingLength == 0)
+        {
+            if (_mFill == 0)
+            {
+                return true;
+            }
+            swap();
+        }
+        const uint32_t written = _mStats.bytesWritten;
+        update();
+        if (_mStats.bytesWritten == written)
+        {
+            return false;
+        }
+    }
+}
+/*************************************************************************
+Description:    Record a received message
+parameter:
+    Input:      message：the message
+                sysEx：the SysEx bytes(SystemExclusive message)
+                time：us, the receive time
+    Output:
+Return:
+Others:         Launched by the MIDI interface(see setRecorder()). The chunks
+                of a SysEx larger than SYS_EX_MAXSIZE carry the parser markers
+                (0xF0...0xF0, 0xF7...0xF0, 0xF7...0xF7), they are not recorded.
+**************************************************************************/
+void MidiFileRecorder::record(const MidiMessage &message, const uint8_t *sysEx, uint32_t time)
+{
+    if (message.type == SystemExclusive)
+    {
+        uint16_t size = uint16_t((message.data2 << 8) | message.data1);//The stream buffer can hold more than SYS_EX_MAXSIZE
+        uint8_t position = 0;
+        if (size != 0 && sysEx[0] == SystemExclusiveStart)
+        {
+            position |= MIDI_SYSEX_START;
+        }
+        else if (size > 1 && sysEx[0] == SystemExclusiveEnd)
+        {
+            sysEx++;//Continuation marker
+            size--;
+        }
+        if (size != 0 && sysEx[size - 1] == SystemExclusiveEnd)
+        {
+            position |= MIDI_SYSEX_END;
+        }
+        else if (size > 1 && sysEx[size - 1] == SystemExclusiveStart)
+        {
+            size--;//Marker of a SysEx going on in the next chunk
+        }
+        recordSysEx(sysEx, size, position, time);
+        return;
+    }
+    if (!_mRecording || !(_mTypeMask & MIDI_TYPE_BIT(message.type)))
+    {
+        return;
+    }
+    const uint32_t tick = timeTick(time);
+    const uint32_t delta = (tick > _mLastTick) ? tick - _mLastTick : 0;//SysEx stamped before a real-time byte sent inside it
+    const uint8_t deltaLength = variableLength(delta);
+
+    if (message.type < SystemExclusive)
+    {
+        const uint8_t status = uint8_t(message.type | ((message.channel - 1) & 0x0f));
+        const uint8_t length = (midiStatusEntry(status) >> 8) & MIDI_STATUS_LENGTH;
+        if (!reserve(deltaLength + (status != _mRunningStatus) + length))
+        {
+            _mStats.dropped++;
+            return;
+        }
+        putVariable(delta);
+        if (status != _mRunningStatus)
+        {
+            put(status);
+            _mRunningStatus = status;
+        }
+        put(message.data1);
+        if (length == 2)
+        {
+            put(message.data2);
+        }
+        _mSysExOpen = false;//A status byte ends an unfinished SysEx
+    }
+    else
+    {
+        //System common and real-time: escaped bytes
+        const uint8_t length = (midiStatusEntry(message.type) >> 8) & MIDI_STATUS_LENGTH;
+        if (!reserve(deltaLength + 3 + length))
+        {
+            _mStats.dropped++;
+            return;
+        }
+        putVariable(delta);
+        put(SystemExclusiveEnd);
+        put(1 + length);
+        put(message.type);
+        if (length >= 1)
+        {
+            put(message.data1);
+        }
+        if (length == 2)
+        {
+            put(message.data2);
+        }
+        _mRunningStatus = 0;
+        if (message.type < Clock)
+        {
+            _mSysExOpen = false;//Real-time bytes can be inside a SysEx, not the others
+        }
+    }
+    _mLastTick += delta;
+    _mStats.events++;
+}
+/*************************************************************************
+Description:    Record a SysEx, or one chunk of a SysEx received in several chunks
+parameter:
+    Input:      array：the SysEx bytes as on the wire(0xF0 first if MIDI_SYSEX_START,
+                       0xF7 last if MIDI_SYSEX_END)
+                size：the number of bytes
+                position：MIDI_SYSEX_START：first chunk；MIDI_SYSEX_END：last chunk
+                time：us, the receive time
+    Output:
+Return:
+Others:         The first chunk is an F0 event, the next ones are F7 continuation
+                events. The chunks after a dropped chunk are dropped too(the
+                streaming chunks parsed by serviceInput() are never recorded).
+                A chunk larger than the free room of the two buffers is dropped:
+                keep the stream buffer below MIDI_RECORD_BUFFER_SIZE.
+**************************************************************************/
+void MidiFileRecorder::recordSysEx(const uint8_t *array, uint16_t size, uint8_t position, uint32_t time)
+{
+    if (!_mRecording || !(_mTypeMask & MIDI_TYPE_BIT(SystemExclusive)))
+    {
+        return;
+    }
+    const bool start = (position & MIDI_SYSEX_START) != 0;
+    if (start)
+    {
+        array++;//The F0 is the event type
+        size--;
+    }
+    else if (!_mSysExOpen)
+    {
+        _mStats.dropped++;//The start of this SysEx was not recorded
+        return;
+    }
+    const uint32_t tick = timeTick(time);
+    const uint32_t delta = (tick > _mLastTick) ? tick - _mLastTick : 0;
+    if (size > 2 * MIDI_RECORD_BUFFER_SIZE || !reserve(variableLength(delta) + 1 + variableLength(size) + size))
+    {
+        _mStats.dropped++;
+        _mSysExOpen = false;
+        return;
+    }
+    putVariable(delta);
+    put(start ? SystemExclusiveStart : SystemExclusiveEnd);
+    putVariable(size);
+    for (uint16_t i = 0; i < size; i++)
+    {
+        put(array[i]);
+    }
+    _mSysExOpen = !(position & MIDI_SYSEX_END);
+    _mRunningStatus = 0;
+    _mLastTick += delta;
+    _mStats.events++;
+}
+/*************************************************************************
+Description:    Get the recorder statistics
+parameter:
+    Input:
+    Output:
+Return:         bytes written, events recorded and dropped, bytes buffered now and at most
+Others:         Cleared by begin()
+**************************************************************************/
+MidiRecorderStats MidiFileRecorder::getStats(void)
+{
+    _mStats.buffered = _mFill + (_mPendingLength - _mPendingIndex);
+    return _mStats;
+}
+/*************************************************************************
+Description:    Check the room left in the buffers
+parameter:
+    Input:      length：the bytes of the event
+    Output:
+Return:         true：the event fits, the buffered bytes high-water mark is updated
+Others:         The other buffer counts only when the sink has written all of it
+**************************************************************************/
+bool MidiFileRecorder::reserve(uint16_t length)
+{
+    const uint16_t room = (MIDI_RECORD_BUFFER_SIZE - _mFill) + ((_mPendingLength == 0) ? MIDI_RECORD_BUFFER_SIZE : 0);
+    if (length > room)
+    {
+        return false;
+    }
+    const uint16_t buffered = _mFill + (_mPendingLength - _mPendingIndex) + length;
+    if (buffered > _mStats.maxBuffered)
+    {
+        _mStats.maxBuffered = buffered;
+    }
+    return true;
+}
+/*************************************************************************
+Description:    Append one byte to the active buffer
+parameter:
+    Input:      data：the byte
+    Output:
+Return:
+Others:         The room has been checked by reserve()
+**************************************************************************/
+void MidiFileRecorder::put(uint8_t data)
+{
+    if (_mFill == MIDI_RECORD_BUFFER_SIZE)
+    {
+        swap();
+    }
+    _mBuffer[_mActive][_mFill++] = data;
+}
+/*************************************************************************
+Description:    Append a variable-length quantity(delta-time, length)
+parameter:
+    Input:      value：the value(28 bits)
+    Output:
+Return:
+Others:
+**************************************************************************/
+void MidiFileRecorder::putVariable(uint32_t value)
+{
+    for (uint8_t shift = 7 * (variableLength(value) - 1); shift != 0; shift -= 7)
+    {
+        put(uint8_t(0x80 | ((value >> shift) & 0x7f)));
+    }
+    put(uint8_t(value & 0x7f));
+}
+/*************************************************************************
+Description:    Append the MThd chunk(type 0, 1 track) and the MTrk chunk header
+parameter:
+    Input:      trackLength：the length of the track chunk
+    Output:
+Return:
+Others:
+**************************************************************************/
+void MidiFileRecorder::putHeader(uint32_t trackLength)
+{
+    const uint8_t header[MIDI_RECORD_HEADER_SIZE] =
+    {
+        'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, uint8_t(MIDI_RECORD_DIVISION >> 8), uint8_t(MIDI_RECORD_DIVISION & 0xff),
+        'M', 'T', 'r', 'k', uint8_t(trackLength >> 24), uint8_t(trackLength >> 16), uint8_t(trackLength >> 8), uint8_t(trackLength)
+    };
+    for (uint8_t i = 0; i < MIDI_RECORD_HEADER_SIZE; i++)
+    {
+        put(header[i]);
+    }
+}
+/*************************************************************************
+Description:    Hand the active buffer to the sink and fill the other one
+parameter:
+    Input:
+    Output:
+Return:
+Others:         The other buffer must be free
+**************************************************************************/
+void MidiFileRecorder::swap(void)
+{
+    _mPendingLength = _mFill;
+    _mPendingIndex = 0;
+    _mActive ^= 1;
+    _mFill = 0;
+}
+/*************************************************************************
+Description:    Convert a receive time to a tick
+parameter:
+    Input:      time：us(micros())
+    Output:
+Return:         the tick from the start of the recording
+Others:         The ticks are added from the time of the previous call, with the
+                rest kept, so the length of the recording is not limited. A time
+                before the previous one(received before begin(), or stamped before
+                an event already recorded) gives the previous tick. A gap between
+                two events must stay below 71 minutes(micros() wraps).
+                The usual gaps(below 0.26s) are converted with a 32-bit multiply.
+**************************************************************************/
+uint32_t MidiFileRecorder::timeTick(uint32_t time)
+{
+    uint32_t elapsed = time - _mTickTime;
+    if (elapsed >= uint32_t(0 - MIDI_RECORD_EARLY))
+    {
+        return _mTick;//Earlier than the previous time
+    }
+    _mTickTime = time;
+    const uint32_t fastLimit = (0xffffffffUL / MIDI_RECORD_TICK_FACTOR - MIDI_RECORD_TICK_UNITS) / MIDI_RECORD_TIME_UNITS;//us
+    if (elapsed <= fastLimit)
+    {
+        //units * factor >> shift is at most 2 ticks below the quotient
+        const uint32_t units = elapsed * MIDI_RECORD_TIME_UNITS + _mTickRest;
+        uint32_t ticks = (units * MIDI_RECORD_TICK_FACTOR) >> MIDI_RECORD_TICK_SHIFT;
+        uint32_t rest = units - ticks * MIDI_RECORD_TICK_UNITS;
+        while (rest >= MIDI_RECORD_TICK_UNITS)
+        {
+            ticks++;
+            rest -= MIDI_RECORD_TICK_UNITS;
+        }
+        _mTickRest = uint16_t(rest);
+        _mTick += ticks;
+        return _mTick;
+    }
+    const uint32_t chunk = (0xffffffffUL - MIDI_RECORD_TICK_UNITS) / MIDI_RECORD_TIME_UNITS;//us
+    while (elapsed != 0)
+    {
+        const uint32_t step = (elapsed > chunk) ? chunk : elapsed;
+        const uint32_t units = step * MIDI_RECORD_TIME_UNITS + _mTickRest;
+        _mTick += units / MIDI_RECORD_TICK_UNITS;
+        _mTickRest = uint16_t(units % MIDI_RECORD_TICK_UNITS);
+        elapsed -= step;
+    }
+    return _mTick;
+}
+/*************************************************************************
+Description:    Get the size of a variable-length quantity
+parameter:
+    Input:      value：the value
+    Output:
+Return:         1 to 4 bytes
+Others:
+**************************************************************************/
+uint8_t MidiFileRecorder::variableLength(uint32_t value)
+{
+    uint8_t length = 1;
+    while ((value >>= 7) != 0 && length < 4)
+    {
+        length++;
+    }
+    return length;
+}
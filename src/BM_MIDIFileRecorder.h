@@ -0,0 +1,82 @@
+/***************************************************************************
+File:       		BM_MIDIFileRecorder.h
+Author:           BESTMODULE
+Description:      Recorder of the received MIDI messages into a Standard MIDI
+                  File(type 0): the events are timed from the receive time and
+                  streamed to any byte sink(SD file, flash) through two buffers
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；Arduino IDE : v1.8.19
+
+****************************************************************************/
+#ifndef _BM_MIDI_FILE_RECORDER_H
+#define _BM_MIDI_FILE_RECORDER_H
+
+#include "BM_MIDIDefine.h"
+
+//Writes length bytes at the given position of the file, returns the number of bytes written(0 to length)
+using MidiFileWriteFunction = size_t (*)(void *sink, uint32_t position, const uint8_t *array, size_t length);
+
+struct MidiRecorderStats{
+    uint32_t bytesWritten; // Bytes written to the sink
+    uint32_t events;       // Events recorded
+    uint16_t dropped;      // Events lost(both buffers full)
+    uint16_t buffered;     // Bytes waiting now
+    uint16_t maxBuffered;  // Most bytes waiting at once
+};
+
+/**************************************************************************************
+The received messages are written in the active buffer by the receive path(launched
+with the callbacks, see setRecorder()), the full buffer is written to the sink by
+update() from loop(): a slow write never delays the reception, it only fills the
+other buffer. When both buffers are full the new events are dropped and counted.
+ - channel messages use running status, the SysEx are F0 events, the system common
+   and real-time messages are F7(escape) events
+ - a SysEx received in several chunks(larger than SYS_EX_MAXSIZE, or than the stream
+   buffer of setSysExStream()) is an F0 event followed by F7 continuation events
+ - one tick is 520.8us(MIDI_RECORD_DIVISION ticks per quarter note at 120 bpm)
+ - Active Sensing is not recorded by default(see setTypeMask())
+The recorder uses 2 x MIDI_RECORD_BUFFER_SIZE + 64 bytes of RAM.
+**************************************************************************************/
+class MidiFileRecorder
+{
+public:
+    MidiFileRecorder();
+    bool begin(void *sink, MidiFileWriteFunction writeFunction);
+    bool end(void);
+    bool update(void);
+    void record(const MidiMessage &message, const uint8_t *sysEx, uint32_t time);
+    void recordSysEx(const uint8_t *array, uint16_t size, uint8_t position, uint32_t time);
+    void setTypeMask(uint32_t mask) { _mTypeMask = mask; }
+    bool isRecording(void) { return _mRecording; }
+    MidiRecorderStats getStats(void);
+
+protected:
+    bool flush(void);//write every buffered byte, waits for the sink
+    bool reserve(uint16_t length);//true:length bytes fit in the buffers
+    void put(uint8_t data);
+    void putVariable(uint32_t value);
+    void putHeader(uint32_t trackLength);
+    void swap(void);//the active buffer becomes the buffer being written
+    uint32_t timeTick(uint32_t time);
+    static uint8_t variableLength(uint32_t value);
+
+    void               *_mSink;
+    MidiFileWriteFunction _mWrite;
+    bool                _mRecording;
+    uint32_t            _mTypeMask;//recorded types, bit midiTypeIndex(type)
+    uint32_t            _mTickTime;//us, time of the last conversion(begin() first)
+    uint32_t            _mTick;//tick at _mTickTime
+    uint16_t            _mTickRest;//time past _mTick, in 1/MIDI_RECORD_TIME_UNITS us
+    uint32_t            _mLastTick;//tick of the last event recorded
+    uint8_t             _mRunningStatus;//status of the last channel event, 0:none
+    bool                _mSysExOpen;//true:the next SysEx chunk is an F7 continuation event
+    uint32_t            _mPosition;//file position of the next byte written to the sink
+    uint8_t             _mBuffer[2][MIDI_RECORD_BUFFER_SIZE];
+    uint8_t             _mActive;//buffer filled by record()
+    uint16_t            _mFill;//bytes in the active buffer
+    uint16_t            _mPendingLength;//bytes of the other buffer to write, 0:free
+    uint16_t            _mPendingIndex;//bytes of the other buffer already written
+    MidiRecorderStats   _mStats;
+};
+
+#endif
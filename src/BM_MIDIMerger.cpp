@@ -0,0 +1,404 @@
+/*************************************************************************
+File:       	  BM_MIDIMerger.cpp
+Author:          BESTMODULES
+Description:    MIDI merger: several MIDI inputs into one output
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； Arduino IDE : v1.8.19
+
+**************************************************************************/
+#include "BM_MIDIMerger.h"
+
+/************************************************************************* 
+Description:    Constructor
+parameter:
+    Input:          output : the interface the merged stream is sent to
+    Output:         
+Return:         
+Others:         The settings of the output are left as they are: with its running
+                status on(setRunningStatus()), a status byte is only sent when it
+                changes, whichever input the message comes from
+*************************************************************************/
+MidiMerger::MidiMerger(MidiInterfaceCore *output)
+{
+    _mOutput = output;
+    _mPortCount = 0;
+    _mSysExOwner = nullptr;
+    _mSysExTime = 0;
+    _mNextPort = 0;
+}
+/************************************************************************* 
+Description:    Add an input to the merger
+parameter:
+    Input:      input：the interface receiving the MIDI input
+    Output:         
+Return:         the input number(for getStats), -1 if MIDI_MERGE_PORTS inputs are used
+Others:         The bytes are taken while the input reads them(isMIDIMessageOK(),
+                drain mode or serviceInput()), its callbacks still work.
+**************************************************************************/
+int8_t MidiMerger::addInput(MidiInterfaceCore *input)
+{
+    if (_mPortCount >= MIDI_MERGE_PORTS)
+    {
+        return -1;
+    }
+    MidiMergerPort &port = _mPorts[_mPortCount];
+    port.merger = this;
+    port.status = 0;
+    port.length = 0;
+    port.index = 0;
+    port.queue.clear();
+    port.sysEx.clear();
+    port.sysExHeld = false;
+    port.sysExLost = false;
+    memset(&port.stats, 0, sizeof(port.stats));
+    input->setHandleReceivedByte(&MidiMerger::receiveByte, &port);
+    return int8_t(_mPortCount++);
+}
+/************************************************************************* 
+Description:    Release the output if the SysEx being merged has stopped for
+                MIDI_MERGE_SYSEX_TIMEOUT ms(input unplugged...)
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         Call it in loop()
+**************************************************************************/
+void MidiMerger::update(void)
+{
+    if (_mSysExOwner != nullptr && (millis() - _mSysExTime) >= MIDI_MERGE_SYSEX_TIMEOUT)
+    {
+        writeSysEx(SystemExclusiveEnd);//Close the truncated SysEx
+        _mSysExOwner->status = 0;
+        releaseSysEx();
+    }
+}
+/************************************************************************* 
+Description:    Get the statistics of an input
+parameter:
+    Input:      port：the input number returned by addInput()
+    Output:         
+Return:         messages sent, held and dropped, queue depth now and at most
+Others:         Compare the messages of the inputs to check the fairness
+**************************************************************************/
+MidiMergerStats MidiMerger::getStats(uint8_t port)
+{
+    MidiMergerStats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (port < _mPortCount)
+    {
+        stats = _mPorts[port].stats;
+        stats.depth = _mPorts[port].queue.count();
+        stats.dropped += _mPorts[port].queue.getOverflowCount();
+    }
+    return stats;
+}
+/************************************************************************* 
+Description:    Byte handler of the inputs
+parameter:
+    Input:      context：the merger input
+                data：the received byte
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiMerger::receiveByte(void *context, uint8_t data)
+{
+    MidiMergerPort *port = static_cast<MidiMergerPort *>(context);
+    port->merger->parseByte(*port, data);
+}
+/************************************************************************* 
+Description:    Assemble the messages of an input
+parameter:
+    Input:      port：the input
+                data：the received byte
+    Output:         
+Return:         
+Others:         Real-time bytes go out at once, even inside a SysEx. The SysEx
+                of the first input starting one is streamed to the output,
+                the other inputs are held until its end, their SysEx too
+                (MIDI_MERGE_SYSEX_SIZE bytes, the rest streamed once released).
+**************************************************************************/
+void MidiMerger::parseByte(MidiMergerPort &port, uint8_t data)
+{
+    if (data >= 0x80)
+    {
+        const uint16_t entry = pgm_read_word(&sMidiStatusTable[data]);
+        const MidiType statusType = MidiType(entry & 0xff);
+        const uint8_t statusFlags = uint8_t(entry >> 8);
+
+        if (statusFlags & MIDI_STATUS_REALTIME)
+        {
+            if (statusType != InvalidType)
+            {
+                _mOutput->sendRealTime(statusType);
+            }
+            return;
+        }
+        if (data == SystemExclusiveEnd)
+        {
+            if (_mSysExOwner == &port)
+            {
+                writeSysEx(data);
+                releaseSysEx();
+            }
+            else if (port.status == SystemExclusiveStart)
+            {
+                holdSysEx(port, data);
+            }
+            port.status = 0;
+            return;
+        }
+        if (_mSysExOwner == &port)
+        {
+            releaseSysEx();//SysEx cancelled by a status byte, the next message ends it on the output too
+        }
+        else if (port.status == SystemExclusiveStart)
+        {
+            holdSysEx(port, SystemExclusiveEnd);//Held SysEx cancelled: closed on the output
+        }
+        port.status = (statusType != InvalidType) ? data : 0;
+        port.length = statusFlags & MIDI_STATUS_LENGTH;
+        port.index = 0;
+        if (data == SystemExclusiveStart)
+        {
+            if (_mSysExOwner == nullptr)
+            {
+                _mSysExOwner = &port;
+                writeSysEx(data);
+            }
+            else
+            {
+                MidiPacket marker = MidiPacket();//Its place among the held messages
+                marker.type = SystemExclusive;
+                if (!port.sysExHeld && port.queue.push(marker))
+                {
+                    port.sysExHeld = true;
+                    port.sysExLost = false;
+                    port.stats.held++;
+                    holdSysEx(port, data);
+                }
+                else
+                {
+                    port.stats.dropped++;//One held SysEx per input: this one is lost
+                    port.status = 0;
+                }
+            }
+        }
+        else if (port.status != 0 && port.length == 0)
+        {
+            MidiPacket message = MidiPacket();//Tune Request
+            message.type = statusType;
+            port.status = 0;
+            deliver(port, message);
+        }
+        return;
+    }
+
+    if (port.status == 0)
+    {
+        return;//Data byte without status
+    }
+    if (port.status == SystemExclusiveStart)
+    {
+        if (_mSysExOwner == &port)
+        {
+            writeSysEx(data);
+        }
+        else
+        {
+            holdSysEx(port, data);
+        }
+        return;
+    }
+    port.data[port.index++] = data;
+    if (port.index < port.length)
+    {
+        return;
+    }
+    port.index = 0;
+
+    MidiPacket message;
+    message.data1 = port.data[0];
+    message.data2 = (port.length == 2) ? port.data[1] : 0;
+    if (port.status < SystemExclusiveStart)
+    {
+        message.type = MidiType(port.status & 0xf0);
+        message.channel = (port.status & 0x0f) + 1;
+    }
+    else
+    {
+        message.type = MidiType(port.status);
+        message.channel = 0;
+        port.status = 0;//System Common messages have no running status
+    }
+    deliver(port, message);
+}
+/************************************************************************* 
+Description:    Send a complete message, or hold it while a SysEx is merged
+parameter:
+    Input:      port：the input
+                message：the message
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiMerger::deliver(MidiMergerPort &port, const MidiPacket &message)
+{
+    if (_mSysExOwner == nullptr)
+    {
+        emit(port, message);
+        return;
+    }
+    if (port.queue.push(message))//Full: counted as overflow
+    {
+        port.stats.held++;
+        const uint8_t depth = port.queue.count();
+        if (depth > port.stats.maxDepth)
+        {
+            port.stats.maxDepth = depth;
+        }
+    }
+}
+/************************************************************************* 
+Description:    Send a message to the output
+parameter:
+    Input:      port：the input it comes from
+                message：the message
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiMerger::emit(MidiMergerPort &port, const MidiPacket &message)
+{
+    if (message.type <= PitchBend)
+    {
+        _mOutput->send(message.type, message.data1, message.data2, message.channel);
+    }
+    else if (message.type == SongPosition)
+    {
+        _mOutput->sendCommon(message.type, message.data1 | (message.data2 << 7));
+    }
+    else
+    {
+        _mOutput->sendCommon(message.type, message.data1);
+    }
+    port.stats.messages++;
+}
+/************************************************************************* 
+Description:    Write a byte of the SysEx being merged
+parameter:
+    Input:      data：the byte
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiMerger::writeSysEx(uint8_t data)
+{
+    _mOutput->writeRaw(&data, 1);
+    _mSysExTime = millis();
+}
+/************************************************************************* 
+Description:    Keep a byte of a SysEx received while another input's SysEx
+                is merged
+parameter:
+    Input:      port：the input
+                data：the byte
+    Output:         
+Return:         
+Others:         A SysEx larger than the buffer is dropped whole when released
+**************************************************************************/
+void MidiMerger::holdSysEx(MidiMergerPort &port, uint8_t data)
+{
+    if (!port.sysEx.push(data))
+    {
+        port.sysExLost = true;
+        port.status = 0;//The rest of the SysEx is ignored
+    }
+}
+/************************************************************************* 
+Description:    Send the held SysEx of an input
+parameter:
+    Input:      port：the input
+    Output:         
+Return:         true：the SysEx is still being received, the input now owns
+                the output until its end
+Others:         
+**************************************************************************/
+bool MidiMerger::replaySysEx(MidiMergerPort &port)
+{
+    port.sysExHeld = false;
+    if (port.sysExLost)
+    {
+        port.sysEx.clear();
+        port.stats.dropped++;
+        return false;
+    }
+    uint8_t block[16];
+    uint8_t length = 0;
+    while (port.sysEx.pop(block[length]))
+    {
+        if (++length == sizeof(block))
+        {
+            _mOutput->writeRaw(block, length);
+            length = 0;
+        }
+    }
+    if (length != 0)
+    {
+        _mOutput->writeRaw(block, length);
+    }
+    _mSysExTime = millis();
+    if (port.status == SystemExclusiveStart)
+    {
+        _mSysExOwner = &port;
+        return true;
+    }
+    port.stats.messages++;
+    return false;
+}
+/************************************************************************* 
+Description:    End the SysEx merging and send the held messages, one message
+                per input in turn
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         The input served first changes at each release. A held SysEx
+                still being received takes the output: the release stops
+                there and goes on at its end.
+**************************************************************************/
+void MidiMerger::releaseSysEx(void)
+{
+    if (_mSysExOwner != nullptr)
+    {
+        _mSysExOwner->stats.messages++;
+        _mSysExOwner = nullptr;
+    }
+    bool pending = true;
+    while (pending)
+    {
+        pending = false;
+        for (uint8_t i = 0; i < _mPortCount; i++)
+        {
+            MidiMergerPort &port = _mPorts[(_mNextPort + i) % _mPortCount];
+            MidiPacket message;
+            if (port.queue.pop(message))
+            {
+                if (message.type != SystemExclusive)
+                {
+                    emit(port, message);
+                }
+                else if (replaySysEx(port))
+                {
+                    _mNextPort = (_mNextPort + i + 1) % _mPortCount;
+                    return;
+                }
+                pending = true;
+            }
+        }
+    }
+    if (_mPortCount != 0)
+    {
+        _mNextPort = (_mNextPort + 1) % _mPortCount;
+    }
+}
@@ -0,0 +1,69 @@
+/***************************************************************************
+File:       		BM_MIDIMerger.h
+Author:           BESTMODULE
+Description:      MIDI merger: several MIDI inputs into one well-formed
+                  output stream(SysEx kept whole, real-time bytes passed at
+                  once, running status across the inputs when the output uses it)
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；Arduino IDE : v1.8.19
+
+****************************************************************************/
+#ifndef _BM_MIDI_MERGER_H
+#define _BM_MIDI_MERGER_H
+
+#include "BMV51M001.h"
+
+/*Statistics of one merger input*/
+struct MidiMergerStats{
+    uint32_t messages;     // Messages sent to the output
+    uint32_t held;         // Messages held while another input was sending a SysEx
+    uint16_t dropped;      // Messages lost(queue full, held SysEx larger than MIDI_MERGE_SYSEX_SIZE)
+    uint8_t depth;         // Messages waiting now
+    uint8_t maxDepth;      // Most messages waiting at once
+};
+
+class MidiMerger;
+
+/*One merger input: the message being assembled and the held messages*/
+struct MidiMergerPort{
+    MidiMerger *merger;
+    uint8_t status;        // Status of the message being received(or running status), 0:none
+    uint8_t length;        // Data bytes of the message
+    uint8_t index;         // Data bytes received
+    uint8_t data[2];
+    MidiRing<MidiPacket, MIDI_MERGE_QUEUE_SIZE> queue;
+    MidiRing<uint8_t, MIDI_MERGE_SYSEX_SIZE> sysEx;//SysEx held while another input's SysEx is merged
+    bool sysExHeld;        // true:the held SysEx has a place in the queue, not sent yet
+    bool sysExLost;        // true:the held SysEx did not fit, it is dropped
+    MidiMergerStats stats;
+};
+
+/*****************class for merging MIDI inputs*******************/
+class MidiMerger
+{
+public:
+    MidiMerger(MidiInterfaceCore *output);
+    int8_t addInput(MidiInterfaceCore *input);
+    void update(void);
+    MidiMergerStats getStats(uint8_t port);
+    uint8_t getInputCount(void) { return _mPortCount; }
+
+protected:
+    static void receiveByte(void *context, uint8_t data);//byte handler of the inputs
+    void parseByte(MidiMergerPort &port, uint8_t data);
+    void deliver(MidiMergerPort &port, const MidiPacket &message);
+    void emit(MidiMergerPort &port, const MidiPacket &message);
+    void writeSysEx(uint8_t data);
+    void holdSysEx(MidiMergerPort &port, uint8_t data);
+    bool replaySysEx(MidiMergerPort &port);
+    void releaseSysEx(void);
+
+    MidiInterfaceCore  *_mOutput;
+    MidiMergerPort      _mPorts[MIDI_MERGE_PORTS];
+    uint8_t             _mPortCount;
+    MidiMergerPort     *_mSysExOwner;//input whose SysEx is being sent, nullptr:none
+    unsigned long       _mSysExTime;//ms, last SysEx byte sent
+    uint8_t             _mNextPort;//round-robin start of the next release
+};
+
+#endif
@@ -0,0 +1,95 @@
+/***************************************************************************
+File:       		BM_MIDINoteTracker.h
+Author:           BESTMODULE
+Description:      Active note tracker: one bit per note and channel(16x128
+                  bits), so a panic only turns off the notes really sounding
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；Arduino IDE : v1.8.19
+
+****************************************************************************/
+#ifndef _BM_MIDI_NOTE_TRACKER_H
+#define _BM_MIDI_NOTE_TRACKER_H
+
+#include "BM_MIDIDefine.h"
+
+/**************************************************************************************
+Channels are 1 to 16 like in the send functions, notes 0 to 127. Each update and
+query is a single bit access. A note on twice is one held note: one NoteOff
+turns it off, as on most receivers. The tracker uses 274 bytes of RAM and is only
+present when the sketch builds one and attaches it(setNoteTracker()).
+**************************************************************************************/
+class MidiNoteTracker
+{
+public:
+    MidiNoteTracker() { clear(); }
+
+    void noteOn(uint8_t channel, uint8_t note)
+    {
+        uint8_t &bits = _notes[(channel - 1) & 0x0f][(note >> 3) & 0x0f];
+        const uint8_t bit = uint8_t(1 << (note & 0x07));
+        if (!(bits & bit))
+        {
+            bits |= bit;
+            _count[(channel - 1) & 0x0f]++;
+            _channels |= uint16_t(1 << ((channel - 1) & 0x0f));
+        }
+    }
+    void noteOff(uint8_t channel, uint8_t note)
+    {
+        uint8_t &bits = _notes[(channel - 1) & 0x0f][(note >> 3) & 0x0f];
+        const uint8_t bit = uint8_t(1 << (note & 0x07));
+        if (bits & bit)
+        {
+            bits &= uint8_t(~bit);
+            if (--_count[(channel - 1) & 0x0f] == 0)
+            {
+                _channels &= uint16_t(~(1 << ((channel - 1) & 0x0f)));
+            }
+        }
+    }
+    bool isNoteOn(uint8_t channel, uint8_t note) const
+    {
+        return (_notes[(channel - 1) & 0x0f][(note >> 3) & 0x0f] >> (note & 0x07)) & 0x01;
+    }
+    //Number of notes held on the channel
+    uint8_t getNoteCount(uint8_t channel) const { return _count[(channel - 1) & 0x0f]; }
+    //Channels with notes held, bit 0:channel 1
+    uint16_t getActiveChannels(void) const { return _channels; }
+    //First note held from the given note up, 128 if none(empty bytes are skipped 8 notes at a time)
+    uint8_t findNote(uint8_t channel, uint8_t from = 0) const
+    {
+        const uint8_t *bits = _notes[(channel - 1) & 0x0f];
+        for (uint8_t note = from; note < 128; note++)
+        {
+            const uint8_t held = uint8_t(bits[note >> 3] >> (note & 0x07));
+            if (held == 0)
+            {
+                note |= 0x07;//Nothing more in this byte
+            }
+            else if (held & 0x01)
+            {
+                return note;
+            }
+        }
+        return 128;
+    }
+    void clear(void)
+    {
+        memset(_notes, 0, sizeof(_notes));
+        memset(_count, 0, sizeof(_count));
+        _channels = 0;
+    }
+    void clear(uint8_t channel)
+    {
+        memset(_notes[(channel - 1) & 0x0f], 0, sizeof(_notes[0]));
+        _count[(channel - 1) & 0x0f] = 0;
+        _channels &= uint16_t(~(1 << ((channel - 1) & 0x0f)));
+    }
+
+private:
+    uint8_t  _notes[16][16];//bit n of byte k:note 8k+n
+    uint8_t  _count[16];
+    uint16_t _channels;
+};
+
+#endif
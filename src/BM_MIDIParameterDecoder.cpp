@@ -0,0 +1,205 @@
+/*************************************************************************
+File:       	  BM_MIDIParameterDecoder.cpp
+Author:          BESTMODULES
+Description:    RPN, NRPN and 14-bit controller decoder
+History：		  
+	V1.0.1	 -- initial version； 2023-01-17； Arduino IDE : v1.8.19
+
+**************************************************************************/
+#include "BM_MIDIParameterDecoder.h"
+
+/*Controller role table: MIDI_CC_xxx of each controller number*/
+#define MIDI_CONTROLLER_ROW(h) \
+    midiControllerClass(h|0x0), midiControllerClass(h|0x1), midiControllerClass(h|0x2), midiControllerClass(h|0x3), \
+    midiControllerClass(h|0x4), midiControllerClass(h|0x5), midiControllerClass(h|0x6), midiControllerClass(h|0x7), \
+    midiControllerClass(h|0x8), midiControllerClass(h|0x9), midiControllerClass(h|0xa), midiControllerClass(h|0xb), \
+    midiControllerClass(h|0xc), midiControllerClass(h|0xd), midiControllerClass(h|0xe), midiControllerClass(h|0xf)
+
+static const uint8_t sMidiControllerTable[128] PROGMEM =
+{
+    MIDI_CONTROLLER_ROW(0x00), MIDI_CONTROLLER_ROW(0x10), MIDI_CONTROLLER_ROW(0x20), MIDI_CONTROLLER_ROW(0x30),
+    MIDI_CONTROLLER_ROW(0x40), MIDI_CONTROLLER_ROW(0x50), MIDI_CONTROLLER_ROW(0x60), MIDI_CONTROLLER_ROW(0x70),
+};
+/************************************************************************* 
+Description:    Decode a received Control Change message
+parameter:
+    Input:      channel：the channel of the message(1 to 16)
+                controlNumber：the controller number(0 to 127)
+                value：the controller value(0 to 127)
+    Output:         
+Return:         MIDI_PARAMETER_RPN, MIDI_PARAMETER_NRPN, MIDI_PARAMETER_CC14：
+                the event completed by the message, read getChannel(),
+                getNumber() and getValue()
+                MIDI_PARAMETER_NONE：no event
+Others:         Call release() first: an MSB waiting for its LSB is replaced
+**************************************************************************/
+uint8_t MidiParameterDecoder::decode(uint8_t channel, uint8_t controlNumber, uint8_t value)
+{
+    ChannelState &state = _channels[(channel - 1) & 0x0f];
+    uint16_t data;
+
+    controlNumber &= 0x7f;
+    value &= 0x7f;
+    _channel = channel;
+    _pendingChannel = 0;
+    switch (pgm_read_byte(&sMidiControllerTable[controlNumber]))
+    {
+        case MIDI_CC_MSB:
+            state.msb[controlNumber] = value;
+            _pendingChannel = channel;
+            _pendingLsb = controlNumber + 32;
+            return MIDI_PARAMETER_NONE;
+        case MIDI_CC_LSB:
+            _number = controlNumber - 32;
+            _value = uint16_t((state.msb[controlNumber - 32] << 7) | value);
+            return MIDI_PARAMETER_CC14;
+        case MIDI_CC_RPN_MSB:
+        case MIDI_CC_NRPN_MSB:
+        case MIDI_CC_RPN_LSB:
+        case MIDI_CC_NRPN_LSB:
+        {
+            const uint8_t select = (controlNumber >= 100) ? MIDI_PARAMETER_RPN : MIDI_PARAMETER_NRPN;
+            if (state.select != select)
+            {
+                state.numberMsb = 0x7f;//The other byte has to be sent again
+                state.numberLsb = 0x7f;
+            }
+            if (controlNumber & 0x01)
+            {
+                state.numberMsb = value;
+            }
+            else
+            {
+                state.numberLsb = value;
+            }
+            state.select = select;
+            state.dataMsb = 0;
+            state.dataLsb = 0;
+            if (select == MIDI_PARAMETER_RPN && state.numberMsb == 0x7f && state.numberLsb == 0x7f)
+            {
+                state.select = MIDI_PARAMETER_NONE;//RPN Null:deselected
+            }
+            return MIDI_PARAMETER_NONE;
+        }
+        case MIDI_CC_DATA_MSB:
+            state.dataMsb = value;
+            state.dataLsb = 0;
+            if (state.select != MIDI_PARAMETER_NONE)
+            {
+                _pendingChannel = channel;
+                _pendingLsb = 38;
+            }
+            return MIDI_PARAMETER_NONE;
+        case MIDI_CC_DATA_LSB:
+            state.dataLsb = value;
+            break;
+        case MIDI_CC_INCREMENT://The value byte is the amount(sendRpnIncrement()), 0 is 1
+            data = uint16_t((state.dataMsb << 7) | state.dataLsb) + (value != 0 ? value : 1);
+            data = (data < 0x3fff) ? data : 0x3fff;
+            state.dataMsb = uint8_t(data >> 7);
+            state.dataLsb = uint8_t(data & 0x7f);
+            break;
+        case MIDI_CC_DECREMENT:
+            data = uint16_t((state.dataMsb << 7) | state.dataLsb);
+            value = (value != 0) ? value : 1;
+            data = (data > value) ? data - value : 0;
+            state.dataMsb = uint8_t(data >> 7);
+            state.dataLsb = uint8_t(data & 0x7f);
+            break;
+        default:
+            return MIDI_PARAMETER_NONE;
+    }
+    if (state.select == MIDI_PARAMETER_NONE)
+    {
+        return MIDI_PARAMETER_NONE;//Data without parameter
+    }
+    _number = uint16_t((state.numberMsb << 7) | state.numberLsb);
+    _value = uint16_t((state.dataMsb << 7) | state.dataLsb);
+    return state.select;
+}
+/************************************************************************* 
+Description:    Give the event of the MSB waiting for its LSB, unless the
+                received message is that LSB
+parameter:
+    Input:      type：the type of the received message
+                channel：the channel of the message(1 to 16)
+                data1：the first data byte(controller number)
+    Output:         
+Return:         the event(see decode()), MIDI_PARAMETER_NONE：no event
+Others:         Call it for each received message, before decode()
+**************************************************************************/
+uint8_t MidiParameterDecoder::release(MidiType type, uint8_t channel, uint8_t data1)
+{
+    if (type == ControlChange && channel == _pendingChannel && (data1 & 0x7f) == _pendingLsb)
+    {
+        return MIDI_PARAMETER_NONE;//decode() makes the event with the LSB
+    }
+    return flush();
+}
+/************************************************************************* 
+Description:    Give the event of the MSB waiting for its LSB now(LSB cleared)
+parameter:
+    Input:          
+    Output:         
+Return:         the event(see decode()), MIDI_PARAMETER_NONE：no event
+Others:         
+**************************************************************************/
+uint8_t MidiParameterDecoder::flush(void)
+{
+    if (_pendingChannel == 0)
+    {
+        return MIDI_PARAMETER_NONE;
+    }
+    const ChannelState &state = _channels[(_pendingChannel - 1) & 0x0f];
+    _channel = _pendingChannel;
+    _pendingChannel = 0;
+    if (_pendingLsb != 38)
+    {
+        _number = uint16_t(_pendingLsb - 32);
+        _value = uint16_t(state.msb[_pendingLsb - 32] << 7);
+        return MIDI_PARAMETER_CC14;
+    }
+    _number = uint16_t((state.numberMsb << 7) | state.numberLsb);
+    _value = uint16_t((state.dataMsb << 7) | state.dataLsb);
+    return state.select;
+}
+/************************************************************************* 
+Description:    Clear the state of every channel(no parameter selected)
+parameter:
+    Input:          
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiParameterDecoder::reset(void)
+{
+    _pendingChannel = 0;
+    _pendingLsb = 0;
+    for (uint8_t channel = 1; channel <= 16; channel++)
+    {
+        reset(channel);
+    }
+    _number = 0;
+    _value = 0;
+    _channel = 1;
+}
+/************************************************************************* 
+Description:    Clear the state of a channel(no parameter selected)
+parameter:
+    Input:      channel：the channel(1 to 16)
+    Output:         
+Return:         
+Others:         
+**************************************************************************/
+void MidiParameterDecoder::reset(uint8_t channel)
+{
+    ChannelState &state = _channels[(channel - 1) & 0x0f];
+    memset(&state, 0, sizeof(state));
+    state.select = MIDI_PARAMETER_NONE;
+    state.numberMsb = 0x7f;
+    state.numberLsb = 0x7f;
+    if (_pendingChannel == channel)
+    {
+        _pendingChannel = 0;
+    }
+}
@@ -0,0 +1,69 @@
+/***************************************************************************
+File:       		BM_MIDIParameterDecoder.h
+Author:           BESTMODULE
+Description:      Receive-side decoder of the RPN, NRPN and 14-bit controller
+                  sequences: the Control Change messages of each channel are
+                  assembled into parameter number and 14-bit value events
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；Arduino IDE : v1.8.19
+
+****************************************************************************/
+#ifndef _BM_MIDI_PARAMETER_DECODER_H
+#define _BM_MIDI_PARAMETER_DECODER_H
+
+#include "BM_MIDIDefine.h"
+
+/**************************************************************************************
+Each Control Change costs one lookup in a 128-byte table giving the role of the
+controller, then a few byte updates in the state of its channel:
+ - 101/100(RPN) and 99/98(NRPN) select the parameter, RPN 127/127 deselects it
+ - 6(Data Entry MSB) gives the value MSB and clears the LSB, 38 gives the LSB,
+   96/97 add or remove their value byte(1 if it is 0) to the value; each one is
+   an RPN or NRPN event
+ - 0 to 31 are the MSB and 32 to 63 the LSB of the 14-bit controllers,
+   the LSB is an event with the last MSB
+One value gives one event: an MSB(Data Entry or 14-bit controller) waits for
+its LSB, the event comes with the LSB or, for a sender of the MSB only, with
+the next message(LSB cleared). release() gives that waiting event: call it
+before decode() for each received message, and flush() when nothing is received
+for a while(MidiInterfaceCore does both, flush() after MIDI_PARAMETER_TIMEOUT).
+Channels are 1 to 16. The decoder uses 598 bytes of RAM.
+**************************************************************************************/
+class MidiParameterDecoder
+{
+public:
+    MidiParameterDecoder() { reset(); }
+
+    uint8_t decode(uint8_t channel, uint8_t controlNumber, uint8_t value);
+    uint8_t release(MidiType type, uint8_t channel, uint8_t data1);
+    uint8_t flush(void);
+    //true:an MSB waits for its LSB(see flush())
+    bool isWaiting(void) const { return _pendingChannel != 0; }
+    //Channel of the last event
+    uint8_t getChannel(void) const { return _channel; }
+    //Parameter number(RPN, NRPN) or controller number(CC14) of the last event
+    uint16_t getNumber(void) const { return _number; }
+    //14-bit value of the last event
+    uint16_t getValue(void) const { return _value; }
+    void reset(void);
+    void reset(uint8_t channel);
+
+private:
+    struct ChannelState
+    {
+        uint8_t select;//MIDI_PARAMETER_RPN, MIDI_PARAMETER_NRPN, MIDI_PARAMETER_NONE
+        uint8_t numberMsb;
+        uint8_t numberLsb;
+        uint8_t dataMsb;
+        uint8_t dataLsb;
+        uint8_t msb[32];//last MSB of the 14-bit controllers
+    };
+    ChannelState _channels[16];
+    uint16_t _number;
+    uint16_t _value;
+    uint8_t _channel;
+    uint8_t _pendingChannel;//channel of the MSB waiting for its LSB, 0:none
+    uint8_t _pendingLsb;//controller number of the LSB it waits for
+};
+
+#endif
@@ -0,0 +1,114 @@
+/***************************************************************************
+File:       		BM_MIDIRing.h
+Author:           BESTMODULE
+Description:      Lock-free single-producer/single-consumer ring buffer
+                  used to pass parsed MIDI messages from the serial receive
+                  context(serialEvent or interrupt) to loop()
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；Arduino IDE : v1.8.19
+
+****************************************************************************/
+#ifndef _BM_MIDI_RING_H
+#define _BM_MIDI_RING_H
+
+#include "BM_MIDIDefine.h"
+
+/**************************************************************************************
+Only the producer writes _tail and only the consumer writes _head, both are single
+bytes so each access is atomic. The acquire/release ordering makes the item copy
+visible before the index that publishes it, so a popped item is never torn.
+Size must be a power of two(2 to 128), one slot is kept free to tell full from empty.
+**************************************************************************************/
+template<typename T, uint8_t Size>
+class MidiRing
+{
+public:
+    MidiRing() : _head(0), _tail(0), _overflow(0) {}
+
+    //Producer side: returns false(and counts an overflow) if the ring is full
+    bool push(const T& item)
+    {
+        const uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+        const uint8_t next = (tail + 1) & (Size - 1);
+        if (next == __atomic_load_n(&_head, __ATOMIC_ACQUIRE))
+        {
+            _overflow++;
+            return false;
+        }
+        _buffer[tail] = item;
+        __atomic_store_n(&_tail, next, __ATOMIC_RELEASE);
+        return true;
+    }
+    //Producer side: push and store a value(arrival time...) at the same slot of
+    //a parallel array of Size values, so the item type does not grow
+    template<typename V>
+    bool push(const T& item, V *values, const V& value)
+    {
+        const uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+        const uint8_t next = (tail + 1) & (Size - 1);
+        if (next == __atomic_load_n(&_head, __ATOMIC_ACQUIRE))
+        {
+            _overflow++;
+            return false;
+        }
+        _buffer[tail] = item;
+        values[tail] = value;
+        __atomic_store_n(&_tail, next, __ATOMIC_RELEASE);
+        return true;
+    }
+    //Consumer side: pop and read the value stored by push(item, values, value)
+    template<typename V>
+    bool pop(T& item, const V *values, V& value)
+    {
+        const uint8_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+        if (head == __atomic_load_n(&_tail, __ATOMIC_ACQUIRE))
+        {
+            return false;
+        }
+        item = _buffer[head];
+        value = values[head];
+        __atomic_store_n(&_head, uint8_t((head + 1) & (Size - 1)), __ATOMIC_RELEASE);
+        return true;
+    }
+    //Consumer side: returns false if the ring is empty
+    bool pop(T& item)
+    {
+        const uint8_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+        if (head == __atomic_load_n(&_tail, __ATOMIC_ACQUIRE))
+        {
+            return false;
+        }
+        item = _buffer[head];
+        __atomic_store_n(&_head, uint8_t((head + 1) & (Size - 1)), __ATOMIC_RELEASE);
+        return true;
+    }
+    //Consumer side: copy the item waiting index places after the oldest one, false if there is none
+    bool peek(uint8_t index, T& item) const
+    {
+        const uint8_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+        if (index >= ((__atomic_load_n(&_tail, __ATOMIC_ACQUIRE) - head) & (Size - 1)))
+        {
+            return false;
+        }
+        item = _buffer[(head + index) & (Size - 1)];
+        return true;
+    }
+    //Number of items waiting(a snapshot when called from either side)
+    uint8_t count(void) const
+    {
+        return (__atomic_load_n(&_tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&_head, __ATOMIC_ACQUIRE)) & (Size - 1);
+    }
+    //Items rejected because the ring was full(written by the producer only)
+    uint16_t getOverflowCount(void) const { return _overflow; }
+    //Only call when neither side is running
+    void clear(void) { _head = 0; _tail = 0; _overflow = 0; }
+
+private:
+    static_assert(Size >= 2 && Size <= 128 && (Size & (Size - 1)) == 0, "MidiRing size must be a power of two");
+    T                   _buffer[Size];
+    volatile uint8_t    _head;//Next item to pop(consumer)
+    volatile uint8_t    _tail;//Next free slot(producer)
+    volatile uint16_t   _overflow;
+};
+
+#endif
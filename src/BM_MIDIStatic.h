@@ -0,0 +1,270 @@
+/***************************************************************************
+File:       		BM_MIDIStatic.h
+Author:           BESTMODULE
+Description:      Receive-only MIDI interface with compile-time handlers:
+                  the handlers are static functions of a policy class, the
+                  parser calls them directly(inlined), and the SysEx and
+                  real-time support can be compiled out
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；Arduino IDE : v1.8.19
+
+****************************************************************************/
+#ifndef _BM_MIDI_STATIC_H
+#define _BM_MIDI_STATIC_H
+
+#include "BM_MIDIDefine.h"
+
+/**************************************************************************************
+Default handler policy: every handler does nothing and every feature is compiled in.
+Derive a policy from it and redefine only the handlers and flags the sketch needs,
+the other handlers are empty inline functions and their code disappears:
+
+    struct MyHandlers : MidiDefaultHandlers
+    {
+        static constexpr bool useSysEx = false;
+        static void noteOn(uint8_t channel, uint8_t note, uint8_t velocity) { ... }
+    };
+    MidiStaticInterface<HardwareSerial, MyHandlers> myMIDIInterface(&Serial);
+**************************************************************************************/
+struct MidiDefaultHandlers
+{
+    static constexpr bool useSysEx = true;      //false：SysEx bytes are skipped, no SysEx buffer
+    static constexpr bool useRealTime = true;   //false：real-time bytes are ignored
+    static constexpr uint16_t sysExSize = SYS_EX_MAXSIZE;//SysEx buffer(0xF0 and 0xF7 included)
+
+    static void noteOff(uint8_t, uint8_t, uint8_t) {}
+    static void noteOn(uint8_t, uint8_t, uint8_t) {}
+    static void afterTouchPoly(uint8_t, uint8_t, uint8_t) {}
+    static void controlChange(uint8_t, uint8_t, uint8_t) {}
+    static void programChange(uint8_t, uint8_t) {}
+    static void afterTouchChannel(uint8_t, uint8_t) {}
+    static void pitchBend(uint8_t, int16_t) {}
+    static void systemExclusive(uint8_t *, uint16_t) {}
+    static void timeCodeQuarterFrame(uint8_t) {}
+    static void songPosition(uint16_t) {}
+    static void songSelect(uint8_t) {}
+    static void tuneRequest(void) {}
+    static void clock(void) {}
+    static void start(void) {}
+    static void continueSong(void) {}
+    static void stop(void) {}
+    static void activeSensing(void) {}
+    static void systemReset(void) {}
+};
+
+/*****************class for the MIDI input with static handlers*******************/
+template<class Transport, class Handlers = MidiDefaultHandlers>
+class MidiStaticInterface
+{
+public:
+    MidiStaticInterface(Transport *theTransport);
+    //default receive data on channel 1
+    void begin(uint8_t inputChannel = 1);
+    bool isMIDIMessageOK(void);
+    uint8_t getInputChannel(void) { return _mInputChannel; }
+    void setInputChannel(uint8_t inputChannel) { _mInputChannel = inputChannel; }
+
+protected:
+    bool parseByte(uint8_t extracted);//parse one byte, launch the handler of a completed message
+    bool launchRealTime(uint8_t status);
+    bool launchMessage(uint8_t status);
+
+    Transport          *_serial;
+    uint8_t             _mInputChannel;
+    uint8_t             _mStatus;//status of the pending message(or of the running status), 0:none
+    uint8_t             _mMidiDatabytes;//data bytes of the pending message
+    uint8_t             _mPendingMessageIndex;
+    uint8_t             _mPendingMessage[2];//data bytes
+    uint16_t            _mSysExLength;
+    uint8_t             _mSysExArray[Handlers::useSysEx ? Handlers::sysExSize : 1];
+};
+
+/*************************************************************************
+Description:    Constructor
+parameter:
+    Input:          *theTransport : the serial port(or any transport) the module is connected to
+    Output:
+Return:
+Others:
+*************************************************************************/
+template<class Transport, class Handlers>
+MidiStaticInterface<Transport, Handlers>::MidiStaticInterface(Transport *theTransport)
+{
+    _serial = theTransport;
+    _mInputChannel = 0;
+    _mStatus = 0;
+    _mMidiDatabytes = 0;
+    _mPendingMessageIndex = 0;
+    _mPendingMessage[0] = 0;
+    _mPendingMessage[1] = 0;
+    _mSysExLength = 0;
+}
+/*************************************************************************
+Description:    MIDI communication initialization
+parameter:
+    Input:          inputChannel：Set the MIDI input channel(1 to 16, MIDI_CHANNEL_OMNI)
+    Output:
+Return:
+Others:
+*************************************************************************/
+template<class Transport, class Handlers>
+void MidiStaticInterface<Transport, Handlers>::begin(uint8_t inputChannel)
+{
+    _serial->begin(31250);
+    _mInputChannel = inputChannel;
+    _mStatus = 0;
+    _mPendingMessageIndex = 0;
+}
+/*************************************************************************
+Description:    Read one byte from the serial port and launch the handler
+                of the message it completes
+parameter:
+    Input:
+    Output:
+Return:         1: if a message on the input channel has been handled
+                0: false if not.
+Others:
+**************************************************************************/
+template<class Transport, class Handlers>
+bool MidiStaticInterface<Transport, Handlers>::isMIDIMessageOK(void)
+{
+    if (_mInputChannel >= MIDI_CHANNEL_OFF || _serial->available() == 0)
+    {
+        return false;
+    }
+    return parseByte(_serial->read());
+}
+/*************************************************************************
+Description:    Parse one received byte
+parameter:
+    Input:      extracted：the byte read from the serial port
+    Output:
+Return:         true：a message has been completed and handled
+Others:         A SysEx larger than sysExSize is truncated(0xF7 is kept)
+**************************************************************************/
+template<class Transport, class Handlers>
+bool MidiStaticInterface<Transport, Handlers>::parseByte(uint8_t extracted)
+{
+    if (extracted >= Clock)
+    {
+        //Interleaved anywhere, the pending message is left as is
+        return Handlers::useRealTime && launchRealTime(extracted);
+    }
+    if (extracted == SystemExclusiveEnd)
+    {
+        const bool complete = Handlers::useSysEx && (_mStatus == SystemExclusiveStart);
+        if (complete)
+        {
+            _mSysExArray[_mSysExLength++] = extracted;
+            Handlers::systemExclusive(_mSysExArray, _mSysExLength);
+        }
+        _mStatus = 0;
+        return complete;
+    }
+    if (extracted >= 0x80)//Any other status byte starts a new message
+    {
+        const uint16_t entry = pgm_read_word(&sMidiStatusTable[extracted]);
+        _mStatus = (uint8_t(entry) == InvalidType) ? 0 : extracted;
+        _mMidiDatabytes = (entry >> 8) & MIDI_STATUS_LENGTH;
+        _mPendingMessageIndex = 0;
+        if (_mStatus == SystemExclusiveStart)
+        {
+            if (!Handlers::useSysEx)
+            {
+                return false;//Its data bytes are ignored like bytes without status
+            }
+            _mSysExArray[0] = extracted;
+            _mSysExLength = 1;
+        }
+        else if (_mStatus != 0 && _mMidiDatabytes == 0)
+        {
+            _mStatus = 0;//Tune Request: 1 byte message
+            return launchMessage(extracted);
+        }
+        return false;
+    }
+
+    if (_mStatus == 0)
+    {
+        return false;//Data byte without status
+    }
+    if (_mStatus == SystemExclusiveStart)
+    {
+        if (Handlers::useSysEx && _mSysExLength < Handlers::sysExSize - 1)
+        {
+            _mSysExArray[_mSysExLength++] = extracted;
+        }
+        return false;
+    }
+    _mPendingMessage[_mPendingMessageIndex++] = extracted;
+    if (_mPendingMessageIndex < _mMidiDatabytes)
+    {
+        return false;//Wait for the next byte
+    }
+    _mPendingMessageIndex = 0;//Channel messages keep their status as running status
+    const uint8_t status = _mStatus;
+    if (status >= SystemExclusiveStart)
+    {
+        _mStatus = 0;
+    }
+    else if (_mInputChannel != MIDI_CHANNEL_OMNI && (status & 0x0f) + 1 != _mInputChannel)
+    {
+        return false;
+    }
+    return launchMessage(status);
+}
+/*************************************************************************
+Description:    Launch the handler of a real-time message
+parameter:
+    Input:      status：the real-time byte
+    Output:
+Return:         false：undefined real-time byte
+Others:
+**************************************************************************/
+template<class Transport, class Handlers>
+bool MidiStaticInterface<Transport, Handlers>::launchRealTime(uint8_t status)
+{
+    switch (status)
+    {
+        case Clock:         Handlers::clock();          return true;
+        case Start:         Handlers::start();          return true;
+        case Continue:      Handlers::continueSong();   return true;
+        case Stop:          Handlers::stop();           return true;
+        case ActiveSensing: Handlers::activeSensing();  return true;
+        case SystemReset:   Handlers::systemReset();    return true;
+        default:            return false;//Undefined_F9 and Undefined_FD
+    }
+}
+/*************************************************************************
+Description:    Launch the handler of a completed channel or system common message
+parameter:
+    Input:      status：the status byte of the message
+    Output:
+Return:         true
+Others:
+**************************************************************************/
+template<class Transport, class Handlers>
+bool MidiStaticInterface<Transport, Handlers>::launchMessage(uint8_t status)
+{
+    const uint8_t channel = (status & 0x0f) + 1;
+    const uint8_t data1 = _mPendingMessage[0];
+    const uint8_t data2 = _mPendingMessage[1];
+    switch (status < SystemExclusiveStart ? (status & 0xf0) : status)
+    {
+        case NoteOff:               Handlers::noteOff(channel, data1, data2);          break;
+        case NoteOn:                Handlers::noteOn(channel, data1, data2);           break;
+        case AfterTouchPoly:        Handlers::afterTouchPoly(channel, data1, data2);   break;
+        case ControlChange:         Handlers::controlChange(channel, data1, data2);    break;
+        case ProgramChange:         Handlers::programChange(channel, data1);           break;
+        case AfterTouchChannel:     Handlers::afterTouchChannel(channel, data1);       break;
+        case PitchBend:             Handlers::pitchBend(channel, (int)((data1 & 0x7f) | ((data2 & 0x7f) << 7)) + MIDI_PITCHBEND_MIN); break;
+        case TimeCodeQuarterFrame:  Handlers::timeCodeQuarterFrame(data1);             break;
+        case SongPosition:          Handlers::songPosition(unsigned((data1 & 0x7f) | ((data2 & 0x7f) << 7))); break;
+        case SongSelect:            Handlers::songSelect(data1);                       break;
+        case TuneRequest:           Handlers::tuneRequest();                           break;
+        default:                    break;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,57 @@
+/***************************************************************************
+File:       		BM_MIDITransport.h
+Author:           BESTMODULE
+Description:      Memory-backed transport for BasicMidiInterface: the MIDI
+                  bytes are read from and written to RAM buffers(loopback,
+                  host tests and benchmarks)
+History：		  -
+	V1.0.1	 -- initial version；2023-01-17；Arduino IDE : v1.8.19
+
+****************************************************************************/
+#ifndef _BM_MIDI_TRANSPORT_H
+#define _BM_MIDI_TRANSPORT_H
+
+#include "BM_MIDIDefine.h"
+
+class MidiMemoryTransport
+{
+public:
+    MidiMemoryTransport(uint8_t *output = nullptr, size_t outputSize = 0)
+        : _input(nullptr), _inputLength(0), _inputIndex(0),
+          _output(output), _outputSize(outputSize), _outputLength(0) {}
+
+    //Bytes returned by read()(the buffer is not copied)
+    void setInput(const uint8_t *input, size_t length) { _input = input; _inputLength = length; _inputIndex = 0; }
+    //Bytes written since the last clearOutput()
+    size_t getOutputLength(void) const { return _outputLength; }
+    void clearOutput(void) { _outputLength = 0; }
+
+    void begin(unsigned long) {}
+    int available(void) { return int(_inputLength - _inputIndex); }
+    int read(void) { return (_inputIndex < _inputLength) ? _input[_inputIndex++] : -1; }
+    int availableForWrite(void) { return int(_outputSize - _outputLength); }
+    size_t write(uint8_t data) { return write(&data, 1); }
+    size_t write(const uint8_t *array, size_t length)
+    {
+        if (length > _outputSize - _outputLength)
+        {
+            length = _outputSize - _outputLength;//Bytes beyond the output buffer are lost
+        }
+        if (length != 0)
+        {
+            memcpy(&_output[_outputLength], array, length);
+            _outputLength += length;
+        }
+        return length;
+    }
+
+private:
+    const uint8_t  *_input;
+    size_t          _inputLength;
+    size_t          _inputIndex;
+    uint8_t        *_output;
+    size_t          _outputSize;
+    size_t          _outputLength;
+};
+
+#endif